@@ -3,8 +3,10 @@
 
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <initializer_list>
 #include <iosfwd>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -241,6 +243,10 @@ class Comm {
   HostRead<I32> host_srcs_;
   Read<I32> dsts_;
   HostRead<I32> host_dsts_;
+  bool uses_nbx_;
+  mutable I32 nbx_rounds_;
+  struct GraphCache;
+  std::shared_ptr<GraphCache> graph_cache_;
 
  public:
   Comm();
@@ -256,13 +262,30 @@ class Comm {
   I32 size() const;
   CommPtr dup() const;
   CommPtr split(I32 color, I32 key) const;
+  /* the ranks that share a node (memory) with this one */
+  CommPtr split_by_node() const;
+  /* the same ranks, reordered so that those sharing a node are
+     contiguous. (node_sizes) receives the number of ranks on
+     each node, in the new order */
+  CommPtr group_by_node(std::vector<I32>* node_sizes) const;
   CommPtr graph(Read<I32> dsts) const;
   CommPtr graph_adjacent(Read<I32> srcs, Read<I32> dsts) const;
   CommPtr graph_inverse() const;
+  /* graph_adjacent(srcs, dsts) and its inverse, reused from an earlier
+     call with the same neighbors when every rank still holds them */
+  void graph_pair(Read<I32> srcs, Read<I32> dsts, CommPtr* p_forward,
+      CommPtr* p_reverse) const;
   Read<I32> sources() const;
   Read<I32> destinations() const;
+  void use_nbx(bool yn);
+  bool uses_nbx() const;
+  void find_sources(Read<I32> dsts, Read<LO> dst_counts, Read<I32>* p_srcs,
+      Read<LO>* p_src_counts) const;
   template <typename T>
   T allreduce(T x, Omega_h_Op op) const;
+  template <typename T>
+  std::vector<T> allreduce(
+      std::vector<T> const& x, std::vector<Omega_h_Op> const& ops) const;
   bool reduce_or(bool x) const;
   bool reduce_and(bool x) const;
   Int128 add_int128(Int128 x) const;
@@ -281,6 +304,43 @@ class Comm {
   void barrier() const;
 };
 
+struct CommStats {
+  CommStats();
+  I64 ncalls;
+  I64 nmsgs_sent;
+  I64 nmsgs_recvd;
+  I64 bytes_sent;
+  I64 bytes_recvd;
+  I32 max_neighbors;
+  Real blocked_time;
+};
+
+/* while a CommPhase exists, communication done through Comm
+   is charged to the phase of that name. when phases are nested,
+   only the innermost one is charged.
+   communication outside of any phase is charged to "other". */
+class CommPhase {
+ public:
+  CommPhase(std::string const& name);
+  ~CommPhase();
+};
+
+std::vector<std::string> get_comm_phases();
+CommStats get_comm_stats(std::string const& phase);
+void reset_comm_stats();
+/* collective over (comm), only rank 0 writes to (stream) */
+void print_comm_stats(CommPtr comm, std::ostream& stream);
+/* have ~Library() print the statistics for the world communicator */
+void report_comm_stats_at_exit(bool yn);
+
+/* bytes of array memory (Write, Read and the like) held right now
+   on this rank, and the most held at once since the last reset.
+   adapt() resets the peak when it starts and reports it at the end.
+   always zero when arrays are Kokkos views */
+I64 array_bytes_in_use();
+I64 array_bytes_peak();
+void reset_array_bytes_peak();
+
 class Dist {
   CommPtr parent_comm_;
   LOs roots2items_[2];
@@ -415,12 +475,26 @@ class Mesh {
   Adj ask_up(Int from, Int to);
   Graph ask_star(Int dim);
   Graph ask_dual();
+  /* entities of (dim) grouped by color, so that no two entities of
+     one color share a vertex. kernels that scatter to vertices can
+     run one color at a time without atomics */
+  Graph ask_colors(Int dim);
+  /* drops a cached adjacency so its memory can be freed. it will be
+     derived again if asked for. the downward adjacencies given
+     to set_ents() can't be dropped */
+  void remove_adj(Int from, Int to);
+  /* drops cached stars, the dual graph and colorings */
+  void remove_neighbor_caches();
 
  public:
   typedef std::shared_ptr<TagBase> TagPtr;
   typedef std::shared_ptr<Adj> AdjPtr;
   typedef std::shared_ptr<Dist> DistPtr;
   typedef std::shared_ptr<inertia::Rib> RibPtr;
+  /* maps the coordinates of some vertices to the values of a
+     field at them. it gets whole arrays, so it can evaluate
+     them in a parallel_for */
+  typedef std::function<Reals(Reals coords)> TagFunction;
 
  private:
   typedef std::vector<TagPtr> TagVector;
@@ -440,9 +514,15 @@ class Mesh {
   LO nents_[DIMS];
   TagVector tags_[DIMS];
   AdjPtr adjs_[DIMS][DIMS];
+  std::shared_ptr<Graph> colors_[DIMS];
   Remotes owners_[DIMS];
   DistPtr dists_[DIMS];
   RibPtr rib_hints_;
+  std::map<std::string, TagFunction> tag_functions_;
+  Omega_h_Partitioner partitioner_;
+  Int parts_per_rank_;
+  Int nghost_layers_;
+  bool ghosts_are_partial_;
   bool keeps_canonical_globals_;
 
  public:
@@ -458,9 +538,25 @@ class Mesh {
   Read<I8> owned(Int dim);
   Dist ask_dist(Int dim);
   void set_parting(Omega_h_Parting parting, bool verbose = false);
+  /* for OMEGA_H_GHOSTED, each rank gets (nlayers) layers of elements
+     around the vertices of its own elements.
+     set_parting(OMEGA_H_GHOSTED) accepts any existing number of layers,
+     this one rebuilds the ghosts if the number differs */
+  void set_parting(Omega_h_Parting parting, Int nlayers, bool verbose = false);
+  Int nghost_layers() const;
+  /* like set_parting(OMEGA_H_GHOSTED), except that only the marked
+     vertices are guaranteed all their adjacent elements.
+     (verts_are_centers) must agree on all copies of a vertex.
+     meshes that are not element-based are ghosted fully */
+  void ghost_partially(Read<I8> verts_are_centers, bool verbose = false);
   void migrate(Remotes new_elems2old_owners, bool verbose = false);
   void reorder();
-  void balance();
+  void balance(bool predictive = false);
+  /* balances the sum of (masses) over the elements of each rank
+     instead of their number. the mesh must be element-based */
+  void balance(Reals masses);
+  Real imbalance(bool predictive = false);
+  Real imbalance(Reals weights);
   Graph ask_graph(Int from, Int to);
   template <typename T>
   Read<T> sync_array(Int ent_dim, Read<T> a, Int width);
@@ -479,6 +575,23 @@ class Mesh {
   bool keeps_canonical_globals() const;
   RibPtr rib_hints() const;
   void set_rib_hints(RibPtr hints);
+  Omega_h_Partitioner partitioner() const;
+  void set_partitioner(Omega_h_Partitioner partitioner);
+  /* with more than one part per rank, balance() cuts the mesh into
+     that many parts per rank once and then moves whole parts.
+     parts are not separate Mesh objects: each element records its
+     part in an element tag, and each rank holds one Mesh with all
+     the elements of the parts assigned to it */
+  Int parts_per_rank() const;
+  void set_parts_per_rank(Int nparts);
+  /* makes the existing vertex tag (name), which should be transferred
+     by OMEGA_H_LINEAR_INTERP or OMEGA_H_METRIC, a function of position.
+     the tag is set to (f) at all vertices now, and refinement then
+     calls (f) at the new vertices instead of interpolating the tag.
+     other vertices keep their values */
+  void set_tag_function(std::string const& name, TagFunction f);
+  bool has_tag_function(std::string const& name) const;
+  TagFunction get_tag_function(std::string const& name) const;
 };
 
 namespace gmsh {
@@ -516,7 +629,81 @@ class FullWriter {
 };
 }  // end namespace vtk
 
+/* what one pass of adapt() did. counts are global, times are
+   the most any rank took, and all ranks see the same values.
+   ghosting includes the migration to and from element-based
+   parting, evaluation is whatever else the pass spent outside
+   of modification and transfer, and bytes_migrated counts the
+   bytes sent by all ranks while ghosting or migrating.
+   passes that found nothing to do have (modified) false */
+struct AdaptPassStats {
+  AdaptPassStats();
+  std::string op;
+  bool modified;
+  GO ncands;
+  GO nkeys;
+  GO nents_before[DIMS];
+  GO nents_after[DIMS];
+  Real min_quality;
+  Real max_quality;
+  Real min_length;
+  Real max_length;
+  Real ghosting_time;
+  Real evaluation_time;
+  Real modification_time;
+  Real transfer_time;
+  I64 bytes_migrated;
+};
+
+struct AdaptStats {
+  AdaptStats();
+  std::vector<AdaptPassStats> passes;
+  Int nrebalances;
+  /* see array_bytes_peak(), zero when arrays are Kokkos views */
+  I64 peak_array_bytes;
+  Real time;
+};
+
+void write_json(std::ostream& stream, AdaptStats const& stats);
+
+struct AdaptOpts {
+  AdaptOpts();
+  Real qual_floor;
+  Real qual_ceil;
+  Real len_floor;
+  Real len_ceil;
+  Int nlayers;
+  Int verbosity;
+  /* before refining, rebalance by the predicted number of
+     elements each element will become (see Mesh::balance) */
+  bool should_balance_predictively;
+  /* between passes, rebalance whenever the busiest rank owns
+     more than this multiple of the average element count
+     (or predicted work, see above). values <= 1 disable this */
+  Real max_imbalance;
+  /* first split edges longer than twice len_ceil all at once by
+     refine_by_templates(), which skips the quality checks of
+     ordinary refinement */
+  bool should_refine_by_templates;
+  /* if not empty, the name of an I8 element tag marking the region
+     to adapt, which should be transferred by OMEGA_H_INHERIT.
+     only the marked elements and (region_nlayers) layers of
+     elements around them are checked, reported and modified */
+  std::string region_name;
+  Int region_nlayers;
+  /* if not empty, the name of a Real element tag holding the work
+     of each element, which the rebalancing above measures and
+     balances instead of element counts or predicted work.
+     it should be transferred by OMEGA_H_INHERIT or similar */
+  std::string weight_name;
+  /* if not null, adapt() fills this with one entry for each pass
+     it ran (one refine, coarsen, swap...), including the passes
+     that did not modify the mesh. each entry costs two reductions */
+  AdaptStats* stats;
+};
+
 /* returns true if the mesh was modified. */
+bool adapt(Mesh* mesh, AdaptOpts const& opts);
 bool adapt(Mesh* mesh, Real qual_floor, Real qual_ceil, Real len_floor,
     Real len_ceil, Int nlayers, Int verbosity);
 
@@ -538,6 +725,11 @@ void build_from_elems_and_coords(
     Mesh* mesh, Library const& lib, Int edim, LOs ev2v, Reals coords);
 void build_box(Mesh* mesh, Library const& lib, Real x, Real y, Real z, LO nx,
     LO ny, LO nz);
+/* splits every element 1:4 (triangles) or 1:8 (tets) (nlevels) times,
+   building each level's entities, global numbers and owners directly
+   from those of the level before. global numbers do not depend on
+   the partitioning */
+void refine_uniformly(Mesh* mesh, Int nlevels);
 
 Real repro_sum(Reals a);
 Real repro_sum(CommPtr comm, Reals a);
@@ -615,6 +807,8 @@ OMEGA_H_INLINE void swap2(T& a, T& b) {
   extern template class HostRead<T>;                                           \
   extern template class HostWrite<T>;                                          \
   extern template T Comm::allreduce(T x, Omega_h_Op op) const;                 \
+  extern template std::vector<T> Comm::allreduce(                              \
+      std::vector<T> const& x, std::vector<Omega_h_Op> const& ops) const;      \
   extern template T Comm::exscan(T x, Omega_h_Op op) const;                    \
   extern template void Comm::bcast(T& x) const;                                \
   extern template Read<T> Comm::allgather(T x) const;                          \
@@ -49,6 +49,14 @@ enum Omega_h_Parting {
   OMEGA_H_VERT_BASED,
 };
 
+enum Omega_h_Partitioner {
+  OMEGA_H_RIB,
+  OMEGA_H_HILBERT,
+  OMEGA_H_MULTILEVEL,
+  /* RIB that first cuts between nodes, then within them */
+  OMEGA_H_NODE_RIB,
+};
+
 enum Omega_h_Comparison { OMEGA_H_SAME, OMEGA_H_MORE, OMEGA_H_DIFF };
 
 enum Omega_h_Outflags {
@@ -1,26 +1,55 @@
 #include "adapt.hpp"
 
+#include <functional>
 #include <iomanip>
 #include <iostream>
 
+#include "adapt_stats.hpp"
 #include "array.hpp"
 #include "coarsen.hpp"
+#include "map.hpp"
 #include "mark.hpp"
 #include "quality.hpp"
 #include "refine.hpp"
+#include "refine_templates.hpp"
 #include "simplices.hpp"
 #include "swap.hpp"
 #include "timer.hpp"
 
 namespace Omega_h {
 
-static void goal_stats(Mesh* mesh, char const* name, Int ent_dim, Reals values,
-    Real floor, Real ceil, Real minval, Real maxval) {
+static LO count_owned_local(Mesh* mesh, Int ent_dim, Read<I8> marks) {
+  if (mesh->could_be_shared(ent_dim)) {
+    marks = land_each(marks, mesh->owned(ent_dim));
+  }
+  return sum(marks);
+}
+
+static LO count_owned_local(Mesh* mesh, Int ent_dim) {
+  if (mesh->could_be_shared(ent_dim)) return sum(mesh->owned(ent_dim));
+  return mesh->nents(ent_dim);
+}
+
+/* appends the local contributions to the (total, low, high)
+   counts of one goal, so that all counts of a summary
+   can be reduced in a single call */
+static void goal_counts(Mesh* mesh, Int ent_dim, Reals values,
+    Read<I8> ents_are_in, Real floor, Real ceil, std::vector<GO>* counts) {
   auto low_marks = each_lt(values, floor);
   auto high_marks = each_gt(values, ceil);
-  auto nlow = count_owned_marks(mesh, ent_dim, low_marks);
-  auto nhigh = count_owned_marks(mesh, ent_dim, high_marks);
-  auto ntotal = mesh->nglobal_ents(ent_dim);
+  if (ents_are_in.exists()) {
+    low_marks = land_each(low_marks, ents_are_in);
+    high_marks = land_each(high_marks, ents_are_in);
+    counts->push_back(GO(count_owned_local(mesh, ent_dim, ents_are_in)));
+  } else {
+    counts->push_back(GO(count_owned_local(mesh, ent_dim)));
+  }
+  counts->push_back(GO(count_owned_local(mesh, ent_dim, low_marks)));
+  counts->push_back(GO(count_owned_local(mesh, ent_dim, high_marks)));
+}
+
+static void goal_stats(Mesh* mesh, char const* name, Int ent_dim, GO ntotal,
+    GO nlow, GO nhigh, Real floor, Real ceil, Real minval, Real maxval) {
   auto nmid = ntotal - nlow - nhigh;
   if (mesh->comm()->rank() == 0) {
     auto precision_before = std::cout.precision();
@@ -43,27 +72,40 @@ static void goal_stats(Mesh* mesh, char const* name, Int ent_dim, Reals values,
   }
 }
 
-static void get_minmax(
-    Mesh* mesh, Reals values, Real* p_minval, Real* p_maxval) {
-  *p_minval = mesh->comm()->allreduce(min(values), OMEGA_H_MIN);
-  *p_maxval = mesh->comm()->allreduce(max(values), OMEGA_H_MAX);
-}
-
-static void adapt_summary(Mesh* mesh, Real qual_floor, Real qual_ceil,
-    Real len_floor, Real len_ceil, Real minqual, Real maxqual, Real minlen,
-    Real maxlen) {
-  goal_stats(mesh, "quality", mesh->dim(), mesh->ask_qualities(), qual_floor,
-      qual_ceil, minqual, maxqual);
-  goal_stats(mesh, "length", EDGE, mesh->ask_lengths(), len_floor, len_ceil,
-      minlen, maxlen);
+static void adapt_summary(Mesh* mesh, Read<I8> elems_are_in,
+    Read<I8> edges_are_in, Real qual_floor, Real qual_ceil, Real len_floor,
+    Real len_ceil, Real minqual, Real maxqual, Real minlen, Real maxlen) {
+  std::vector<GO> counts;
+  goal_counts(mesh, mesh->dim(), mesh->ask_qualities(), elems_are_in,
+      qual_floor, qual_ceil, &counts);
+  goal_counts(mesh, EDGE, mesh->ask_lengths(), edges_are_in, len_floor,
+      len_ceil, &counts);
+  counts = mesh->comm()->allreduce(
+      counts, std::vector<Omega_h_Op>(counts.size(), OMEGA_H_SUM));
+  goal_stats(mesh, "quality", mesh->dim(), counts[0], counts[1], counts[2],
+      qual_floor, qual_ceil, minqual, maxqual);
+  goal_stats(mesh, "length", EDGE, counts[3], counts[4], counts[5], len_floor,
+      len_ceil, minlen, maxlen);
 }
 
 bool adapt_check(Mesh* mesh, Real qual_floor, Real qual_ceil, Real len_floor,
-    Real len_ceil, bool verbose) {
-  Real minqual, maxqual;
-  get_minmax(mesh, mesh->ask_qualities(), &minqual, &maxqual);
-  Real minlen, maxlen;
-  get_minmax(mesh, mesh->ask_lengths(), &minlen, &maxlen);
+    Real len_ceil, bool verbose, Read<I8> elems_are_in) {
+  auto quals = mesh->ask_qualities();
+  auto lens = mesh->ask_lengths();
+  Read<I8> edges_are_in;
+  if (elems_are_in.exists()) {
+    edges_are_in = mark_down(mesh, mesh->dim(), EDGE, elems_are_in);
+    quals = unmap(collect_marked(elems_are_in), quals, 1);
+    lens = unmap(collect_marked(edges_are_in), lens, 1);
+  }
+  auto extrema = mesh->comm()->allreduce(
+      std::vector<Real>({min(quals), max(quals), min(lens), max(lens)}),
+      std::vector<Omega_h_Op>(
+          {OMEGA_H_MIN, OMEGA_H_MAX, OMEGA_H_MIN, OMEGA_H_MAX}));
+  auto minqual = extrema[0];
+  auto maxqual = extrema[1];
+  auto minlen = extrema[2];
+  auto maxlen = extrema[3];
   if (qual_ceil <= minqual && len_floor <= minlen && maxlen <= len_ceil) {
     if (verbose && mesh->comm()->rank() == 0) {
       std::cout << "mesh is good: quality [" << minqual << "," << maxqual
@@ -72,8 +114,8 @@ bool adapt_check(Mesh* mesh, Real qual_floor, Real qual_ceil, Real len_floor,
     return true;
   }
   if (verbose) {
-    adapt_summary(mesh, qual_floor, qual_ceil, len_floor, len_ceil, minqual,
-        maxqual, minlen, maxlen);
+    adapt_summary(mesh, elems_are_in, edges_are_in, qual_floor, qual_ceil,
+        len_floor, len_ceil, minqual, maxqual, minlen, maxlen);
   }
   return false;
 }
@@ -83,56 +125,198 @@ static void do_histogram(Mesh* mesh) {
   if (mesh->comm()->rank() == 0) print_quality_histogram(histogram);
 }
 
-bool adapt(Mesh* mesh, Real qual_floor, Real qual_ceil, Real len_floor,
-    Real len_ceil, Int nlayers, Int verbosity) {
+AdaptOpts::AdaptOpts()
+    : qual_floor(0.30),
+      qual_ceil(0.30),
+      len_floor(1.0 / 2.0),
+      len_ceil(3.0 / 2.0),
+      nlayers(4),
+      verbosity(1),
+      should_balance_predictively(false),
+      max_imbalance(-1.0),
+      should_refine_by_templates(false),
+      region_nlayers(2),
+      stats(nullptr) {}
+
+/* the elements that adapt() may check and modify, or a
+   nonexistent array if that is the whole mesh. the layers are
+   grown once per pass: they are kept in a tag that migrates
+   with the mesh but is dropped by every modification */
+static Read<I8> get_region(Mesh* mesh, AdaptOpts const& opts) {
+  if (opts.region_name.empty()) return Read<I8>();
+  auto dim = mesh->dim();
+  if (!mesh->has_tag(dim, "omega_h_region")) {
+    auto marks = mesh->get_array<I8>(dim, opts.region_name);
+    marks = mark_vert_layers(mesh, marks, opts.region_nlayers);
+    mesh->add_tag(dim, "omega_h_region", 1, OMEGA_H_DONT_TRANSFER,
+        OMEGA_H_DONT_OUTPUT, marks);
+  }
+  return mesh->get_array<I8>(dim, "omega_h_region");
+}
+
+/* as above, for operations that begin by moving to (parting) */
+static Read<I8> get_region(
+    Mesh* mesh, AdaptOpts const& opts, Omega_h_Parting parting) {
+  if (!opts.region_name.empty()) mesh->set_parting(parting);
+  return get_region(mesh, opts);
+}
+
+static void clear_region(Mesh* mesh) {
+  if (mesh->has_tag(mesh->dim(), "omega_h_region")) {
+    mesh->remove_tag(mesh->dim(), "omega_h_region");
+  }
+}
+
+/* swapping inherits element tags from the key edges, so an
+   element-only region tag is copied down to the edges meanwhile */
+static bool swap_region(Mesh* mesh, AdaptOpts const& opts) {
+  auto elems_are_in = get_region(mesh, opts, OMEGA_H_GHOSTED);
+  auto const& name = opts.region_name;
+  auto copy_down = elems_are_in.exists() && !mesh->has_tag(EDGE, name);
+  if (copy_down) {
+    auto marks = mesh->get_array<I8>(mesh->dim(), name);
+    mesh->add_tag(EDGE, name, 1, OMEGA_H_INHERIT, OMEGA_H_DONT_OUTPUT,
+        mark_down(mesh, mesh->dim(), EDGE, marks));
+  }
+  auto modified = swap_edges(mesh, opts.qual_ceil, opts.nlayers,
+      (opts.verbosity >= 2), elems_are_in);
+  if (copy_down) mesh->remove_tag(EDGE, name);
+  return modified;
+}
+
+static Real min_quality(Mesh* mesh, Read<I8> elems_are_in) {
+  if (!elems_are_in.exists()) return mesh->min_quality();
+  auto quals = mesh->ask_qualities();
+  return min(mesh->comm(), unmap(collect_marked(elems_are_in), quals, 1));
+}
+
+/* runs one pass, recording it in (opts.stats) if that exists */
+static bool run_pass(Mesh* mesh, AdaptOpts const& opts, char const* op,
+    std::function<bool()> const& pass) {
+  if (!opts.stats) return pass();
+  AdaptPassStats pass_stats;
+  pass_stats.op = op;
+  begin_adapt_pass(mesh, &pass_stats);
+  pass_stats.modified = pass();
+  end_adapt_pass(mesh);
+  opts.stats->passes.push_back(pass_stats);
+  return pass_stats.modified;
+}
+
+static void rebalance_if_needed(
+    Mesh* mesh, AdaptOpts const& opts, Int* nrebalances) {
+  if (opts.max_imbalance <= 1.0) return;
+  if (mesh->comm()->size() == 1) return;
+  auto has_weights = !opts.weight_name.empty();
+  auto imbalance = has_weights
+                       ? mesh->imbalance(mesh->get_array<Real>(
+                             mesh->dim(), opts.weight_name))
+                       : mesh->imbalance(opts.should_balance_predictively);
+  if (imbalance <= opts.max_imbalance) return;
+  if ((opts.verbosity >= 2) && mesh->comm()->rank() == 0) {
+    std::cout << "imbalance " << imbalance << " exceeds "
+              << opts.max_imbalance << ", rebalancing\n";
+  }
+  if (has_weights) {
+    mesh->set_parting(OMEGA_H_ELEM_BASED);
+    mesh->balance(mesh->get_array<Real>(mesh->dim(), opts.weight_name));
+  } else {
+    mesh->balance(opts.should_balance_predictively);
+  }
+  ++(*nrebalances);
+}
+
+bool adapt(Mesh* mesh, AdaptOpts const& opts) {
   Now t0 = now();
   auto comm = mesh->comm();
+  auto qual_floor = opts.qual_floor;
+  auto qual_ceil = opts.qual_ceil;
+  auto len_floor = opts.len_floor;
+  auto len_ceil = opts.len_ceil;
+  auto nlayers = opts.nlayers;
+  auto verbosity = opts.verbosity;
   CHECK(0.0 <= qual_floor);
   CHECK(qual_floor <= qual_ceil);
   CHECK(qual_ceil <= 1.0);
   CHECK(0.0 < len_floor);
   CHECK(2.0 * len_floor <= len_ceil);
+  reset_array_bytes_peak();
+  if (opts.stats) *opts.stats = AdaptStats();
   if (verbosity >= 1 && comm->rank() == 0) {
     std::cout << "before adapting:\n";
   }
-  if (adapt_check(
-          mesh, qual_floor, qual_ceil, len_floor, len_ceil, (verbosity >= 1))) {
+  clear_region(mesh);
+  if (adapt_check(mesh, qual_floor, qual_ceil, len_floor, len_ceil,
+          (verbosity >= 1), get_region(mesh, opts))) {
+    clear_region(mesh);
     return false;
   }
   if (verbosity >= 3) do_histogram(mesh);
-  auto input_qual = mesh->min_quality();
+  if (opts.should_balance_predictively && comm->size() > 1) {
+    if ((verbosity >= 2) && comm->rank() == 0) {
+      std::cout << "balancing by predicted work\n";
+    }
+    mesh->balance(true);
+  }
+  auto input_qual = min_quality(mesh, get_region(mesh, opts));
   CHECK(input_qual > 0.0);
   auto allow_qual = min2(qual_floor, input_qual);
+  Int nrebalances = 0;
   Now t1 = now();
   if ((verbosity >= 2) && comm->rank() == 0) {
     std::cout << "addressing edge lengths\n";
   }
-  while (refine_by_size(mesh, len_ceil, allow_qual, (verbosity >= 2))) {
+  while (opts.should_refine_by_templates &&
+         run_pass(mesh, opts, "refine_by_templates", [&]() {
+           return refine_by_templates(mesh, 2.0 * len_ceil, (verbosity >= 2),
+               get_region(mesh, opts, OMEGA_H_ELEM_BASED));
+         })) {
+    rebalance_if_needed(mesh, opts, &nrebalances);
+  }
+  while (run_pass(mesh, opts, "refine", [&]() {
+    return refine_by_size(mesh, len_ceil, allow_qual, (verbosity >= 2),
+        get_region(mesh, opts));
+  })) {
+    rebalance_if_needed(mesh, opts, &nrebalances);
     if (verbosity >= 2) {
-      adapt_check(mesh, qual_floor, qual_ceil, len_floor, len_ceil);
+      adapt_check(mesh, qual_floor, qual_ceil, len_floor, len_ceil, true,
+          get_region(mesh, opts));
     }
   }
-  while (coarsen_by_size(mesh, len_floor, allow_qual, (verbosity >= 2))) {
+  while (run_pass(mesh, opts, "coarsen", [&]() {
+    return coarsen_by_size(mesh, len_floor, allow_qual, (verbosity >= 2),
+        get_region(mesh, opts));
+  })) {
+    rebalance_if_needed(mesh, opts, &nrebalances);
     if (verbosity >= 2) {
-      adapt_check(mesh, qual_floor, qual_ceil, len_floor, len_ceil);
+      adapt_check(mesh, qual_floor, qual_ceil, len_floor, len_ceil, true,
+          get_region(mesh, opts));
     }
   }
   Now t2 = now();
   bool first = true;
-  while (mesh->min_quality() < qual_ceil) {
+  while (min_quality(mesh, get_region(mesh, opts)) < qual_ceil) {
     if ((verbosity >= 2) && first && comm->rank() == 0) {
       std::cout << "addressing element qualities\n";
     }
     if (first) first = false;
-    if (swap_edges(mesh, qual_ceil, nlayers, (verbosity >= 2))) {
+    if (run_pass(
+            mesh, opts, "swap", [&]() { return swap_region(mesh, opts); })) {
+      rebalance_if_needed(mesh, opts, &nrebalances);
       if (verbosity >= 2) {
-        adapt_check(mesh, qual_floor, qual_ceil, len_floor, len_ceil);
+        adapt_check(mesh, qual_floor, qual_ceil, len_floor, len_ceil, true,
+          get_region(mesh, opts));
       }
       continue;
     }
-    if (coarsen_slivers(mesh, qual_ceil, nlayers, (verbosity >= 2))) {
+    if (run_pass(mesh, opts, "coarsen_slivers", [&]() {
+          return coarsen_slivers(mesh, qual_ceil, nlayers, (verbosity >= 2),
+              get_region(mesh, opts, OMEGA_H_GHOSTED));
+        })) {
+      rebalance_if_needed(mesh, opts, &nrebalances);
       if (verbosity >= 2) {
-        adapt_check(mesh, qual_floor, qual_ceil, len_floor, len_ceil);
+        adapt_check(mesh, qual_floor, qual_ceil, len_floor, len_ceil, true,
+          get_region(mesh, opts));
       }
       continue;
     }
@@ -145,8 +329,10 @@ bool adapt(Mesh* mesh, Real qual_floor, Real qual_ceil, Real len_floor,
     if (comm->rank() == 0) {
       std::cout << "after adapting:\n";
     }
-    adapt_check(mesh, qual_floor, qual_ceil, len_floor, len_ceil);
+    adapt_check(mesh, qual_floor, qual_ceil, len_floor, len_ceil, true,
+        get_region(mesh, opts));
   }
+  clear_region(mesh);
   Now t3 = now();
   if (verbosity >= 3) do_histogram(mesh);
   if (verbosity >= 1 && comm->rank() == 0) {
@@ -156,10 +342,46 @@ bool adapt(Mesh* mesh, Real qual_floor, Real qual_ceil, Real len_floor,
     std::cout << "addressing element qualities took " << (t3 - t2)
               << " seconds\n";
   }
+  if (nrebalances && verbosity >= 1 && comm->rank() == 0) {
+    std::cout << "rebalanced " << nrebalances << " times\n";
+  }
+  /* array memory is not counted for Kokkos views, so there is
+     nothing to print unless stats are also being recorded */
+#ifdef OMEGA_H_USE_KOKKOS
+  auto prints_peak = false;
+#else
+  auto prints_peak = (verbosity >= 1);
+#endif
+  if (prints_peak || opts.stats) {
+    auto maxima = comm->allreduce(
+        std::vector<Real>({Real(array_bytes_peak()), t3 - t0}),
+        std::vector<Omega_h_Op>({OMEGA_H_MAX, OMEGA_H_MAX}));
+    auto peak = I64(maxima[0]);
+    if (prints_peak && comm->rank() == 0) {
+      std::cout << "peak array memory on one rank " << peak << " bytes\n";
+    }
+    if (opts.stats) {
+      opts.stats->nrebalances = nrebalances;
+      opts.stats->peak_array_bytes = peak;
+      opts.stats->time = maxima[1];
+    }
+  }
   if (verbosity >= 1 && comm->rank() == 0) {
     std::cout << "adapting took " << (t3 - t0) << " seconds\n\n";
   }
   return true;
 }
 
+bool adapt(Mesh* mesh, Real qual_floor, Real qual_ceil, Real len_floor,
+    Real len_ceil, Int nlayers, Int verbosity) {
+  AdaptOpts opts;
+  opts.qual_floor = qual_floor;
+  opts.qual_ceil = qual_ceil;
+  opts.len_floor = len_floor;
+  opts.len_ceil = len_ceil;
+  opts.nlayers = nlayers;
+  opts.verbosity = verbosity;
+  return adapt(mesh, opts);
+}
+
 }  // end namespace Omega_h
@@ -9,9 +9,11 @@ namespace Omega_h {
    length requirements, print a short
    message and return true.
    otherwise, print a more detailed
-   statistical report and return false */
+   statistical report and return false.
+   if (elems_are_in) exists, only the marked
+   elements and their edges are considered */
 bool adapt_check(Mesh* mesh, Real qual_floor, Real qual_ceil, Real len_floor,
-    Real len_ceil, bool verbose = true);
+    Real len_ceil, bool verbose = true, Read<I8> elems_are_in = Read<I8>());
 
 }  // end namespace Omega_h
 
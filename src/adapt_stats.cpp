@@ -0,0 +1,186 @@
+#include "adapt_stats.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+#include "array.hpp"
+#include "map.hpp"
+#include "timer.hpp"
+
+namespace Omega_h {
+
+AdaptPassStats::AdaptPassStats()
+    : modified(false),
+      ncands(0),
+      nkeys(0),
+      min_quality(0.0),
+      max_quality(0.0),
+      min_length(0.0),
+      max_length(0.0),
+      ghosting_time(0.0),
+      evaluation_time(0.0),
+      modification_time(0.0),
+      transfer_time(0.0),
+      bytes_migrated(0) {
+  for (Int i = 0; i < DIMS; ++i) nents_before[i] = nents_after[i] = 0;
+}
+
+AdaptStats::AdaptStats() : nrebalances(0), peak_array_bytes(0), time(0.0) {}
+
+static AdaptPassStats* current_pass = nullptr;
+static GO local_ncands = 0;
+static GO local_nkeys = 0;
+static GO local_nents_before[DIMS];
+static I64 bytes_before = 0;
+static std::vector<AdaptWork> work_stack;
+static Real work_times[ADAPT_TRANSFER + 1];
+static Now last_mark;
+
+static I64 migration_bytes() {
+  return get_comm_stats("ghosting").bytes_sent +
+         get_comm_stats("migration").bytes_sent;
+}
+
+static void count_owned_ents(Mesh* mesh, GO* counts) {
+  for (Int i = 0; i < DIMS; ++i) {
+    if (i > mesh->dim()) {
+      counts[i] = 0;
+    } else if (mesh->could_be_shared(i)) {
+      counts[i] = sum(mesh->owned(i));
+    } else {
+      counts[i] = mesh->nents(i);
+    }
+  }
+}
+
+static void charge_time() {
+  auto t = now();
+  work_times[work_stack.back()] += (t - last_mark);
+  last_mark = t;
+}
+
+void begin_adapt_pass(Mesh* mesh, AdaptPassStats* pass) {
+  CHECK(current_pass == nullptr);
+  current_pass = pass;
+  local_ncands = 0;
+  local_nkeys = 0;
+  count_owned_ents(mesh, local_nents_before);
+  bytes_before = migration_bytes();
+  for (auto& t : work_times) t = 0.0;
+  work_stack.assign(1, ADAPT_EVALUATION);
+  last_mark = now();
+}
+
+void end_adapt_pass(Mesh* mesh) {
+  CHECK(current_pass != nullptr);
+  charge_time();
+  auto pass = current_pass;
+  current_pass = nullptr;
+  work_stack.clear();
+  GO local_nents_after[DIMS];
+  count_owned_ents(mesh, local_nents_after);
+  std::vector<GO> counts = {local_ncands, local_nkeys};
+  counts.insert(counts.end(), local_nents_before, local_nents_before + DIMS);
+  counts.insert(counts.end(), local_nents_after, local_nents_after + DIMS);
+  counts.push_back(migration_bytes() - bytes_before);
+  counts = mesh->comm()->allreduce(
+      counts, std::vector<Omega_h_Op>(counts.size(), OMEGA_H_SUM));
+  pass->ncands = counts[0];
+  pass->nkeys = counts[1];
+  for (Int i = 0; i < DIMS; ++i) {
+    pass->nents_before[i] = counts[2 + i];
+    pass->nents_after[i] = counts[2 + DIMS + i];
+  }
+  pass->bytes_migrated = counts[2 + 2 * DIMS];
+  auto quals = mesh->ask_qualities();
+  auto lens = mesh->ask_lengths();
+  auto reals = mesh->comm()->allreduce(
+      std::vector<Real>({min(quals), max(quals), min(lens), max(lens),
+          work_times[ADAPT_GHOSTING], work_times[ADAPT_EVALUATION],
+          work_times[ADAPT_MODIFICATION], work_times[ADAPT_TRANSFER]}),
+      std::vector<Omega_h_Op>({OMEGA_H_MIN, OMEGA_H_MAX, OMEGA_H_MIN,
+          OMEGA_H_MAX, OMEGA_H_MAX, OMEGA_H_MAX, OMEGA_H_MAX, OMEGA_H_MAX}));
+  pass->min_quality = reals[0];
+  pass->max_quality = reals[1];
+  pass->min_length = reals[2];
+  pass->max_length = reals[3];
+  pass->ghosting_time = reals[4];
+  pass->evaluation_time = reals[5];
+  pass->modification_time = reals[6];
+  pass->transfer_time = reals[7];
+}
+
+static GO count_owned(Mesh* mesh, Int ent_dim, Read<I8> marks) {
+  if (mesh->could_be_shared(ent_dim)) {
+    marks = land_each(marks, mesh->owned(ent_dim));
+  }
+  return sum(marks);
+}
+
+void record_adapt_cands(Mesh* mesh, Int ent_dim, Read<I8> ents_are_cands) {
+  if (!current_pass) return;
+  local_ncands += count_owned(mesh, ent_dim, ents_are_cands);
+}
+
+void record_adapt_keys(Mesh* mesh, Int key_dim, LOs keys2kds) {
+  if (!current_pass) return;
+  if (mesh->could_be_shared(key_dim)) {
+    local_nkeys += sum(unmap(keys2kds, mesh->owned(key_dim), 1));
+  } else {
+    local_nkeys += keys2kds.size();
+  }
+}
+
+AdaptTimer::AdaptTimer(AdaptWork work) : is_active_(current_pass != nullptr) {
+  if (!is_active_) return;
+  charge_time();
+  work_stack.push_back(work);
+}
+
+AdaptTimer::~AdaptTimer() {
+  if (!is_active_) return;
+  charge_time();
+  work_stack.pop_back();
+}
+
+static void write_counts(std::ostream& stream, GO const* counts) {
+  stream << '[';
+  for (Int i = 0; i < DIMS; ++i) stream << (i ? ", " : "") << counts[i];
+  stream << ']';
+}
+
+void write_json(std::ostream& stream, AdaptStats const& stats) {
+  auto precision_before = stream.precision();
+  stream << std::setprecision(17);
+  stream << "{\n";
+  stream << "  \"time\": " << stats.time << ",\n";
+  stream << "  \"nrebalances\": " << stats.nrebalances << ",\n";
+  stream << "  \"peak_array_bytes\": " << stats.peak_array_bytes << ",\n";
+  stream << "  \"passes\": [";
+  for (std::size_t i = 0; i < stats.passes.size(); ++i) {
+    auto const& pass = stats.passes[i];
+    stream << (i ? ",\n" : "\n");
+    stream << "    {\"op\": \"" << pass.op << "\", ";
+    stream << "\"modified\": " << (pass.modified ? "true" : "false") << ", ";
+    stream << "\"ncands\": " << pass.ncands << ", ";
+    stream << "\"nkeys\": " << pass.nkeys << ", ";
+    stream << "\"nents_before\": ";
+    write_counts(stream, pass.nents_before);
+    stream << ", \"nents_after\": ";
+    write_counts(stream, pass.nents_after);
+    stream << ", \"min_quality\": " << pass.min_quality;
+    stream << ", \"max_quality\": " << pass.max_quality;
+    stream << ", \"min_length\": " << pass.min_length;
+    stream << ", \"max_length\": " << pass.max_length;
+    stream << ", \"ghosting_time\": " << pass.ghosting_time;
+    stream << ", \"evaluation_time\": " << pass.evaluation_time;
+    stream << ", \"modification_time\": " << pass.modification_time;
+    stream << ", \"transfer_time\": " << pass.transfer_time;
+    stream << ", \"bytes_migrated\": " << pass.bytes_migrated << "}";
+  }
+  stream << (stats.passes.empty() ? "]\n" : "\n  ]\n");
+  stream << "}\n";
+  stream.precision(precision_before);
+}
+
+}  // end namespace Omega_h
@@ -0,0 +1,39 @@
+#ifndef ADAPT_STATS_HPP
+#define ADAPT_STATS_HPP
+
+#include "internal.hpp"
+
+namespace Omega_h {
+
+/* while adapt() runs a pass with statistics requested, the
+   functions below charge the work of the mesh modification
+   routines to that pass. otherwise they do nothing */
+void begin_adapt_pass(Mesh* mesh, AdaptPassStats* pass);
+/* collective, fills in the global values of the pass */
+void end_adapt_pass(Mesh* mesh);
+
+void record_adapt_cands(Mesh* mesh, Int ent_dim, Read<I8> ents_are_cands);
+void record_adapt_keys(Mesh* mesh, Int key_dim, LOs keys2kds);
+
+enum AdaptWork {
+  ADAPT_EVALUATION,
+  ADAPT_GHOSTING,
+  ADAPT_MODIFICATION,
+  ADAPT_TRANSFER
+};
+
+/* charges the time until its destruction to (work), pausing
+   whichever AdaptTimer encloses it. time outside of any
+   AdaptTimer is evaluation */
+class AdaptTimer {
+ public:
+  AdaptTimer(AdaptWork work);
+  ~AdaptTimer();
+
+ private:
+  bool is_active_;
+};
+
+}  // end namespace Omega_h
+
+#endif
@@ -4,6 +4,7 @@
 #include "Omega_h_functors.hpp"
 #include "access.hpp"
 #include "adapt.hpp"
+#include "adapt_stats.hpp"
 #include "adjacency.hpp"
 #include "algebra.hpp"
 #include "align.hpp"
@@ -17,7 +18,9 @@
 #include "classify.hpp"
 #include "coarsen.hpp"
 #include "collapse.hpp"
+#include "coloring.hpp"
 #include "comm.hpp"
+#include "comm_stats.hpp"
 #include "consistent.hpp"
 #include "construct.hpp"
 #include "derive.hpp"
@@ -37,6 +40,7 @@
 #include "metric.hpp"
 #include "migrate.hpp"
 #include "modify.hpp"
+#include "multilevel.hpp"
 #include "owners.hpp"
 #include "polynomial.hpp"
 #include "protect.hpp"
@@ -44,6 +48,7 @@
 #include "quality.hpp"
 #include "refine.hpp"
 #include "refine_qualities.hpp"
+#include "refine_templates.hpp"
 #include "refine_topology.hpp"
 #include "remotes.hpp"
 #include "reorder.hpp"
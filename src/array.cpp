@@ -10,6 +10,33 @@ template <typename T>
 Write<T>::Write(Kokkos::View<T*> view) : view_(view), exists_(true) {}
 #endif
 
+static I64 bytes_in_use = 0;
+static I64 bytes_peak = 0;
+
+I64 array_bytes_in_use() { return bytes_in_use; }
+
+I64 array_bytes_peak() { return bytes_peak; }
+
+void reset_array_bytes_peak() { bytes_peak = bytes_in_use; }
+
+#ifndef OMEGA_H_USE_KOKKOS
+template <typename T>
+struct CountedDelete {
+  I64 nbytes;
+  void operator()(T* p) const {
+    bytes_in_use -= nbytes;
+    delete[] p;
+  }
+};
+
+template <typename T>
+static T* counted_new(LO size) {
+  bytes_in_use += I64(size) * I64(sizeof(T));
+  bytes_peak = max2(bytes_peak, bytes_in_use);
+  return new T[size];
+}
+#endif
+
 template <typename T>
 Write<T>::Write(LO size)
     :
@@ -17,7 +44,8 @@ Write<T>::Write(LO size)
       view_(Kokkos::ViewAllocateWithoutInitializing("omega_h"),
           static_cast<std::size_t>(size))
 #else
-      ptr_(new T[size], std::default_delete<T[]>()),
+      ptr_(counted_new<T>(size),
+          CountedDelete<T>{I64(size) * I64(sizeof(T))}),
       size_(size)
 #endif
       ,
@@ -173,7 +201,7 @@ T min(CommPtr comm, Read<T> a) {
 
 template <typename T>
 T max(CommPtr comm, Read<T> a) {
-  return comm->allreduce(min(a), OMEGA_H_MAX);
+  return comm->allreduce(max(a), OMEGA_H_MAX);
 }
 
 Reals::Reals() : Read<Real>() {}
@@ -202,6 +230,15 @@ bool are_close(Reals a, Reals b, Real tol, Real floor) {
       parallel_reduce(a.size(), AreClose(a, b, tol, floor)));
 }
 
+Read<I64> quantize_masses(Reals masses, Real max_mass) {
+  if (!(max_mass > 0.0)) return Read<I64>(masses.size(), 1);
+  auto unit = max_mass / exp2(20.0);
+  Write<I64> out(masses.size());
+  auto f = LAMBDA(LO i) { out[i] = static_cast<I64>(masses[i] / unit + 0.5); };
+  parallel_for(masses.size(), f);
+  return out;
+}
+
 LOs::LOs(Write<LO> write) : Read<LO>(write) {}
 
 LOs::LOs(LO size, LO value) : Read<LO>(size, value) {}
@@ -28,6 +28,10 @@ T max(CommPtr comm, Read<T> a);
 
 bool are_close(Reals a, Reals b, Real tol = EPSILON, Real floor = EPSILON);
 
+/* masses as integers in units of 2^-20 of (max_mass), so that
+   weight sums are exact and do not depend on the order of summation */
+Read<I64> quantize_masses(Reals masses, Real max_mass);
+
 template <typename T>
 Read<T> multiply_each_by(T factor, Read<T> a);
 template <typename T>
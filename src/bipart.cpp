@@ -7,14 +7,14 @@
 
 namespace Omega_h {
 
-Dist bi_partition(CommPtr comm, Read<I8> marks) {
-  CHECK(comm->size() % 2 == 0);
+Dist bi_partition(CommPtr comm, Read<I8> marks, I32 nlow) {
+  CHECK(0 < nlow && nlow < comm->size());
   Write<I32> dest_ranks(marks.size());
   Write<LO> dest_idxs(marks.size());
   LO linsize = -1;
-  auto halfsize = comm->size() / 2;
   I32 rank_start = 0;
   for (Int half = 0; half < 2; ++half) {
+    auto halfsize = (half == 0) ? nlow : (comm->size() - nlow);
     marks = invert_marks(marks);
     auto marked = collect_marked(marks);
     auto total = comm->allreduce(GO(marked.size()), OMEGA_H_SUM);
@@ -33,4 +33,8 @@ Dist bi_partition(CommPtr comm, Read<I8> marks) {
   return Dist(comm, dests, linsize);
 }
 
+Dist bi_partition(CommPtr comm, Read<I8> marks) {
+  return bi_partition(comm, marks, comm->size() / 2);
+}
+
 }  // end namespace Omega_h
@@ -9,12 +9,15 @@ namespace Omega_h {
    for each item indicating which half of the new
    partitioning it belongs in, construct a Dist
    object that maps current items to their destinations,
-   such that the first half of the ranks have
-   all the items marked 0 and the second half
-   of the ranks have all the items marked 1.
+   such that the first (nlow) ranks have
+   all the items marked 0 and the remaining
+   ranks have all the items marked 1.
    this is a useful subroutine for parallel
    sort-like operations (RIB in particular) */
 
+Dist bi_partition(CommPtr comm, Read<I8> marks, I32 nlow);
+
+/* same as above with (nlow = comm->size() / 2) */
 Dist bi_partition(CommPtr comm, Read<I8> marks);
 
 }  // end namespace Omega_h
@@ -2,6 +2,7 @@
 
 #include <iostream>
 
+#include "adapt_stats.hpp"
 #include "array.hpp"
 #include "collapse.hpp"
 #include "indset.hpp"
@@ -42,6 +43,7 @@ static bool coarsen_element_based1(Mesh* mesh) {
   auto comm = mesh->comm();
   auto edge_cand_codes = get_edge_codes(mesh);
   auto edges_are_cands = each_neq_to(edge_cand_codes, I8(DONT_COLLAPSE));
+  record_adapt_cands(mesh, EDGE, edges_are_cands);
   auto cands2edges = collect_marked(edges_are_cands);
   auto cand_codes = unmap(cands2edges, edge_cand_codes, 1);
   cand_codes = check_collapse_class(mesh, cands2edges, cand_codes);
@@ -117,9 +119,13 @@ static void coarsen_element_based2(Mesh* mesh, bool verbose) {
       rail_col_dirs);
   auto dead_ents = mark_dead_ents(mesh, rails2edges, rail_col_dirs);
   auto keys2verts_onto = get_verts_onto(mesh, rails2edges, rail_col_dirs);
+  record_adapt_keys(mesh, VERT, keys2verts);
+  AdaptTimer timer(ADAPT_MODIFICATION);
+  release_for_modify(mesh);
   auto new_mesh = mesh->copy_meta();
   auto old_verts2new_verts = LOs();
   auto old_lows2new_lows = LOs();
+  auto low_prods2new_lows = LOs();
   for (Int ent_dim = 0; ent_dim <= mesh->dim(); ++ent_dim) {
     auto keys2prods = LOs();
     auto prod_verts2verts = LOs();
@@ -138,19 +144,28 @@ static void coarsen_element_based2(Mesh* mesh, bool verbose) {
     auto same_ents2new_ents = LOs();
     auto old_ents2new_ents = LOs();
     modify_ents(mesh, &new_mesh, ent_dim, VERT, keys2verts, keys2prods,
-        prod_verts2verts, old_lows2new_lows, &prods2new_ents,
-        &same_ents2old_ents, &same_ents2new_ents, &old_ents2new_ents);
+        prod_verts2verts, old_lows2new_lows, low_prods2new_lows,
+        &prods2new_ents, &same_ents2old_ents, &same_ents2new_ents,
+        &old_ents2new_ents);
     if (ent_dim == VERT) old_verts2new_verts = old_ents2new_ents;
     transfer_coarsen(mesh, &new_mesh, keys2verts, keys2doms, ent_dim,
         prods2new_ents, same_ents2old_ents, same_ents2new_ents);
     old_lows2new_lows = old_ents2new_ents;
+    low_prods2new_lows = prods2new_ents;
+    release_modified_dim(mesh, ent_dim, VERT);
   }
   *mesh = new_mesh;
 }
 
 bool coarsen(Mesh* mesh, Real min_qual, bool improve, bool verbose) {
   if (!coarsen_element_based1(mesh)) return false;
-  mesh->set_parting(OMEGA_H_GHOSTED);
+  if (mesh->parting() == OMEGA_H_ELEM_BASED) {
+    auto edge_codes = mesh->get_array<I8>(EDGE, "collapse_code");
+    auto edges_are_cands = each_neq_to(edge_codes, I8(DONT_COLLAPSE));
+    mesh->ghost_partially(mark_down(mesh, EDGE, VERT, edges_are_cands));
+  } else {
+    mesh->set_parting(OMEGA_H_GHOSTED);
+  }
   if (!coarsen_ghosted(mesh, min_qual, improve)) return false;
   mesh->set_parting(OMEGA_H_ELEM_BASED);
   coarsen_element_based2(mesh, verbose);
@@ -182,18 +197,22 @@ bool coarsen_ents(Mesh* mesh, Int ent_dim, Read<I8> marks, Real min_qual,
   return coarsen_verts(mesh, vert_marks, min_qual, improve, verbose);
 }
 
-bool coarsen_by_size(Mesh* mesh, Real min_len, Real min_qual, bool verbose) {
+bool coarsen_by_size(Mesh* mesh, Real min_len, Real min_qual, bool verbose,
+    Read<I8> elems_are_in) {
   auto comm = mesh->comm();
   auto lengths = mesh->ask_lengths();
   auto edge_is_cand = each_lt(lengths, min_len);
+  edge_is_cand = restrict_to_region(mesh, EDGE, edge_is_cand, elems_are_in);
   if (comm->allreduce(max(edge_is_cand), OMEGA_H_MAX) != 1) return false;
   return coarsen_ents(mesh, EDGE, edge_is_cand, min_qual, false, verbose);
 }
 
-bool coarsen_slivers(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose) {
+bool coarsen_slivers(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose,
+    Read<I8> elems_are_in) {
   mesh->set_parting(OMEGA_H_GHOSTED);
   auto comm = mesh->comm();
-  auto elems_are_cands = mark_sliver_layers(mesh, qual_ceil, nlayers);
+  auto elems_are_cands =
+      mark_sliver_layers(mesh, qual_ceil, nlayers, elems_are_in);
   CHECK(comm->allreduce(max(elems_are_cands), OMEGA_H_MAX) == 1);
   return coarsen_ents(mesh, mesh->dim(), elems_are_cands, 0.0, true, verbose);
 }
@@ -40,9 +40,14 @@ bool coarsen_verts(
 bool coarsen_ents(Mesh* mesh, Int ent_dim, Read<I8> marks, Real min_qual,
     bool improve, bool verbose);
 
-bool coarsen_by_size(Mesh* mesh, Real min_len, Real min_qual, bool verbose);
-
-bool coarsen_slivers(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose);
+/* for these two, only entities in the closure of the elements
+   marked by (elems_are_in), if it exists, are candidates.
+   coarsen_slivers() expects (elems_are_in) on the ghosted mesh */
+bool coarsen_by_size(Mesh* mesh, Real min_len, Real min_qual, bool verbose,
+    Read<I8> elems_are_in = Read<I8>());
+
+bool coarsen_slivers(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose,
+    Read<I8> elems_are_in = Read<I8>());
 
 }  // end namespace Omega_h
 
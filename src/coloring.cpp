@@ -0,0 +1,81 @@
+#include "coloring.hpp"
+
+#include <cstdint>
+
+#include "array.hpp"
+#include "graph.hpp"
+#include "indset.hpp"
+#include "loop.hpp"
+#include "map.hpp"
+
+namespace Omega_h {
+
+namespace coloring {
+
+/* colors are chosen 64 at a time: each neighbor sets a bit for its
+   color if it falls in the current window */
+INLINE LO smallest_free_color(LOs xadj, LOs adj, LOs colors, LO v) {
+  for (LO base = 0;; base += 64) {
+    std::uint64_t used = 0;
+    for (auto j = xadj[v]; j < xadj[v + 1]; ++j) {
+      auto c = colors[adj[j]] - base;
+      if (0 <= c && c < 64) used |= (std::uint64_t(1) << c);
+    }
+    if (~used) {
+      LO c = 0;
+      while (used & (std::uint64_t(1) << c)) ++c;
+      return base + c;
+    }
+  }
+}
+
+/* Jones-Plassmann: each round, uncolored nodes whose priority beats
+   all their uncolored neighbors take the smallest free color.
+   no two of them are neighbors, so they never conflict */
+static LOs local_iteration(LOs xadj, LOs adj, Read<I64> priorities,
+    LOs old_colors) {
+  auto n = old_colors.size();
+  Write<LO> new_colors = deep_copy(old_colors);
+  auto f = LAMBDA(LO v) {
+    if (old_colors[v] >= 0) return;
+    for (auto j = xadj[v]; j < xadj[v + 1]; ++j) {
+      auto u = adj[j];
+      if (u == v || old_colors[u] >= 0) continue;
+      if (priorities[u] > priorities[v]) return;
+      if (priorities[u] == priorities[v] && u > v) return;
+    }
+    new_colors[v] = smallest_free_color(xadj, adj, old_colors, v);
+  };
+  parallel_for(n, f);
+  return new_colors;
+}
+}
+
+LOs color_graph(Graph g) {
+  auto xadj = g.a2ab;
+  auto adj = g.ab2b;
+  auto n = xadj.size() - 1;
+  Write<I64> priorities(n);
+  auto f = LAMBDA(LO v) { priorities[v] = hash_global(v); };
+  parallel_for(n, f);
+  auto colors = LOs(n, -1);
+  while (n && min(colors) < 0) {
+    colors = coloring::local_iteration(xadj, adj, priorities, colors);
+  }
+  return colors;
+}
+
+LOs color_by_shared(Graph a2b, Graph b2a) {
+  /* the (a) neighbors of each (a2b) use, concatenated per (a).
+     this includes each (a) itself, which color_graph skips */
+  auto ab2a = unmap_graph(a2b.ab2b, b2a);
+  auto a2a = Graph(unmap(a2b.a2ab, ab2a.a2ab, 1), ab2a.ab2b);
+  return color_graph(a2a);
+}
+
+Graph group_by_color(LOs colors) {
+  auto ncolors = colors.size() ? (max(colors) + 1) : 0;
+  return invert_map_by_sorting(colors, ncolors);
+}
+
+}  // end namespace Omega_h
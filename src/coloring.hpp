@@ -0,0 +1,22 @@
+#ifndef COLORING_HPP
+#define COLORING_HPP
+
+#include "internal.hpp"
+
+namespace Omega_h {
+
+/* colors the nodes of (g) so that no two neighbors share a color.
+   colors are small and dense, starting at zero, and the result only
+   depends on (g), not on thread scheduling */
+LOs color_graph(Graph g);
+
+/* colors the (a) entities so that no two that share a (b) entity
+   have the same color (distance-2 coloring of the (a, b) graph) */
+LOs color_by_shared(Graph a2b, Graph b2a);
+
+/* groups entities by color, ready for one parallel_for per color */
+Graph group_by_color(LOs colors);
+
+}  // end namespace Omega_h
+
+#endif
@@ -1,20 +1,136 @@
 #include "comm.hpp"
 
+#include <algorithm>
+#include <map>
+
 #include "array.hpp"
+#include "comm_stats.hpp"
 #include "int128.hpp"
+#include "timer.hpp"
 
 namespace Omega_h {
 
 #define CALL(f) CHECK(MPI_SUCCESS == (f))
 
-Comm::Comm() {
+static I64 message_bytes_limit = I64(1) << 30;
+
+/* pairs of graph communicators created by graph_pair(),
+   keyed by the (sources, destinations) of the forward one.
+   entries don't keep the communicators alive, they are
+   only reused while some Dist still holds them. */
+struct Comm::GraphCache {
+  typedef std::pair<std::vector<I32>, std::vector<I32>> Key;
+  struct Entry {
+    std::weak_ptr<Comm> forward;
+    std::weak_ptr<Comm> reverse;
+    I64 id;
+  };
+  std::map<Key, Entry> entries;
+  I64 ncreated;
+  GraphCache() : ncreated(0) {}
+  /* a cached pair can only be reused if every rank finds the
+     same one, otherwise ranks would disagree about whether to
+     collectively create a new one. one allreduce settles this
+     for both directions. the creation counter identifies pairs
+     consistently across ranks since creation is collective */
+  bool find(Comm const* comm, Key const& key, CommPtr* p_forward,
+      CommPtr* p_reverse) {
+    I64 id = -1;
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+      *p_forward = it->second.forward.lock();
+      *p_reverse = it->second.reverse.lock();
+      if (*p_forward && *p_reverse) id = it->second.id;
+    }
+    auto ids = comm->allreduce(std::vector<I64>({id, id}),
+        std::vector<Omega_h_Op>({OMEGA_H_MIN, OMEGA_H_MAX}));
+    return ids[0] == ids[1] && ids[0] != -1;
+  }
+  void insert(Key const& key, CommPtr forward, CommPtr reverse) {
+    for (auto it = entries.begin(); it != entries.end();) {
+      if (it->second.forward.expired() || it->second.reverse.expired())
+        it = entries.erase(it);
+      else
+        ++it;
+    }
+    Entry entry;
+    entry.forward = forward;
+    entry.reverse = reverse;
+    entry.id = ncreated++;
+    entries[key] = entry;
+  }
+};
+
+#ifdef OMEGA_H_USE_MPI
+static std::vector<I32> to_vector(HostRead<I32> a) {
+  return std::vector<I32>(a.data(), a.data() + a.size());
+}
+#endif
+
+/* NBX needs MPI_Ibarrier from MPI 3.0. it is also the default
+   because it finds sources in rank order, while the order of
+   sources reported by MPI_Dist_graph_create is up to the
+   MPI implementation */
+#if defined(OMEGA_H_USE_MPI) && (MPI_VERSION >= 3)
+static bool const nbx_by_default = true;
+#else
+static bool const nbx_by_default = false;
+#endif
+
+#ifdef OMEGA_H_USE_MPI
+/* collectives over the whole communicator are counted
+   as one message each way */
+static void record_collective(I64 nbytes, Now t0) {
+  record_comm(1, nbytes, 1, nbytes, 0, now() - t0);
+}
+
+/* neighbor exchanges count one message per neighbor,
+   except messages between this rank and itself */
+struct Traffic {
+  I64 nmsgs;
+  I64 nbytes;
+  Traffic() : nmsgs(0), nbytes(0) {}
+  void add(I32 self, I32 peer, I64 msg_bytes) {
+    if (peer == self) return;
+    ++nmsgs;
+    nbytes += msg_bytes;
+  }
+};
+
+static void record_neighbor_exch(Traffic sent, Traffic recvd, Now t0) {
+  record_comm(sent.nmsgs, sent.nbytes, recvd.nmsgs, recvd.nbytes,
+      I32(max2(sent.nmsgs, recvd.nmsgs)), now() - t0);
+}
+
+static void record_neighbor_exch(I32 self, HostRead<I32> srcs,
+    HostRead<I32> dsts, I64 msg_bytes, Now t0) {
+  Traffic sent, recvd;
+  for (LO i = 0; i < dsts.size(); ++i) sent.add(self, dsts[i], msg_bytes);
+  for (LO i = 0; i < srcs.size(); ++i) recvd.add(self, srcs[i], msg_bytes);
+  record_neighbor_exch(sent, recvd, t0);
+}
+#endif
+
+static CommPtr inherit_options(Comm const* parent, CommPtr child) {
+  child->use_nbx(parent->uses_nbx());
+  return child;
+}
+
+Comm::Comm()
+    : uses_nbx_(nbx_by_default),
+      nbx_rounds_(0),
+      graph_cache_(new GraphCache()) {
 #ifdef OMEGA_H_USE_MPI
   impl_ = MPI_COMM_NULL;
 #endif
 }
 
 #ifdef OMEGA_H_USE_MPI
-Comm::Comm(MPI_Comm impl) : impl_(impl) {
+Comm::Comm(MPI_Comm impl)
+    : impl_(impl),
+      uses_nbx_(nbx_by_default),
+      nbx_rounds_(0),
+      graph_cache_(new GraphCache()) {
   int topo_type;
   CALL(MPI_Topo_test(impl, &topo_type));
   if (topo_type == MPI_DIST_GRAPH) {
@@ -32,7 +148,10 @@ Comm::Comm(MPI_Comm impl) : impl_(impl) {
   }
 }
 #else
-Comm::Comm(bool is_graph, bool sends_to_self) {
+Comm::Comm(bool is_graph, bool sends_to_self)
+    : uses_nbx_(nbx_by_default),
+      nbx_rounds_(0),
+      graph_cache_(new GraphCache()) {
   if (is_graph) {
     if (sends_to_self) {
       srcs_ = Read<LO>({0});
@@ -98,9 +217,10 @@ CommPtr Comm::dup() const {
 #ifdef OMEGA_H_USE_MPI
   MPI_Comm impl2;
   CALL(MPI_Comm_dup(impl_, &impl2));
-  return CommPtr(new Comm(impl2));
+  return inherit_options(this, CommPtr(new Comm(impl2)));
 #else
-  return CommPtr(new Comm(srcs_.exists(), srcs_.exists() && srcs_.size() == 1));
+  return inherit_options(this,
+      CommPtr(new Comm(srcs_.exists(), srcs_.exists() && srcs_.size() == 1)));
 #endif
 }
 
@@ -108,14 +228,43 @@ CommPtr Comm::split(I32 color, I32 key) const {
 #ifdef OMEGA_H_USE_MPI
   MPI_Comm impl2;
   CALL(MPI_Comm_split(impl_, color, key, &impl2));
-  return CommPtr(new Comm(impl2));
+  return inherit_options(this, CommPtr(new Comm(impl2)));
 #else
   (void)color;
   (void)key;
-  return CommPtr(new Comm());
+  return inherit_options(this, CommPtr(new Comm()));
+#endif
+}
+
+CommPtr Comm::split_by_node() const {
+#if defined(OMEGA_H_USE_MPI) && (MPI_VERSION >= 3)
+  MPI_Comm impl2;
+  CALL(MPI_Comm_split_type(
+      impl_, MPI_COMM_TYPE_SHARED, rank(), MPI_INFO_NULL, &impl2));
+  return inherit_options(this, CommPtr(new Comm(impl2)));
+#else
+  /* without MPI 3.0 we can't tell, so each rank is its own node */
+  return split(rank(), 0);
 #endif
 }
 
+CommPtr Comm::group_by_node(std::vector<I32>* node_sizes) const {
+  auto node = split_by_node();
+  /* nodes are named and ordered by their lowest rank */
+  auto leader = node->allreduce(rank(), OMEGA_H_MIN);
+  std::vector<I32> sizes(std::size_t(size()), 0);
+  if (node->rank() == 0) sizes[std::size_t(leader)] = node->size();
+  sizes = allreduce(sizes, std::vector<Omega_h_Op>(sizes.size(), OMEGA_H_SUM));
+  I32 key = node->rank();
+  node_sizes->clear();
+  for (I32 r = 0; r < size(); ++r) {
+    if (!sizes[std::size_t(r)]) continue;
+    if (r < leader) key += sizes[std::size_t(r)];
+    node_sizes->push_back(sizes[std::size_t(r)]);
+  }
+  return split(0, key);
+}
+
 CommPtr Comm::graph(Read<I32> dsts) const {
 #ifdef OMEGA_H_USE_MPI
   MPI_Comm impl2;
@@ -126,25 +275,40 @@ CommPtr Comm::graph(Read<I32> dsts) const {
   int reorder = 0;
   CALL(MPI_Dist_graph_create(impl_, n, sources, degrees, destinations.data(),
       OMEGA_H_MPI_UNWEIGHTED, MPI_INFO_NULL, reorder, &impl2));
-  return CommPtr(new Comm(impl2));
+  return inherit_options(this, CommPtr(new Comm(impl2)));
 #else
-  return CommPtr(new Comm(true, dsts.size() == 1));
+  return inherit_options(this, CommPtr(new Comm(true, dsts.size() == 1)));
 #endif
 }
 
 CommPtr Comm::graph_adjacent(Read<I32> srcs, Read<I32> dsts) const {
 #ifdef OMEGA_H_USE_MPI
-  MPI_Comm impl2;
   HostRead<I32> sources(srcs);
   HostRead<I32> destinations(dsts);
+  MPI_Comm impl2;
   int reorder = 0;
   CALL(MPI_Dist_graph_create_adjacent(impl_, sources.size(), sources.data(),
       OMEGA_H_MPI_UNWEIGHTED, destinations.size(), destinations.data(),
       OMEGA_H_MPI_UNWEIGHTED, MPI_INFO_NULL, reorder, &impl2));
-  return CommPtr(new Comm(impl2));
+  return inherit_options(this, CommPtr(new Comm(impl2)));
 #else
   CHECK(srcs == dsts);
-  return CommPtr(new Comm(true, dsts.size() == 1));
+  return inherit_options(this, CommPtr(new Comm(true, dsts.size() == 1)));
+#endif
+}
+
+void Comm::graph_pair(Read<I32> srcs, Read<I32> dsts, CommPtr* p_forward,
+    CommPtr* p_reverse) const {
+#ifdef OMEGA_H_USE_MPI
+  auto key = GraphCache::Key(
+      to_vector(HostRead<I32>(srcs)), to_vector(HostRead<I32>(dsts)));
+  if (graph_cache_->find(this, key, p_forward, p_reverse)) return;
+  *p_forward = graph_adjacent(srcs, dsts);
+  *p_reverse = graph_adjacent(dsts, srcs);
+  graph_cache_->insert(key, *p_forward, *p_reverse);
+#else
+  *p_forward = graph_adjacent(srcs, dsts);
+  *p_reverse = graph_adjacent(dsts, srcs);
 #endif
 }
 
@@ -156,17 +320,164 @@ Read<I32> Comm::sources() const { return srcs_; }
 
 Read<I32> Comm::destinations() const { return dsts_; }
 
+void Comm::use_nbx(bool yn) { uses_nbx_ = yn; }
+
+bool Comm::uses_nbx() const { return uses_nbx_; }
+
+/* given the ranks we will send messages to and the size of
+   each message, find the ranks that will send messages to us
+   (sorted by rank) and the size of those messages.
+   this uses the NBX sparse dynamic data exchange algorithm
+   (synchronous sends, then a non-blocking barrier once all of
+   them have been matched), which avoids creating a
+   distributed graph communicator just to learn the sources */
+void Comm::find_sources(Read<I32> dsts, Read<LO> dst_counts,
+    Read<I32>* p_srcs, Read<LO>* p_src_counts) const {
+  CHECK(dsts.size() == dst_counts.size());
+#ifdef OMEGA_H_USE_MPI
+#if MPI_VERSION < 3
+  auto g = graph(dsts);
+  *p_srcs = g->sources();
+  *p_src_counts = g->alltoall(dst_counts);
+#else
+  /* consecutive rounds alternate tags, so a message from a rank
+     that has already moved on to the next round can't be
+     mistaken for one belonging to this round */
+  int const tag = 43 + (nbx_rounds_++ % 2);
+  HostRead<I32> destinations(dsts);
+  HostRead<LO> counts(dst_counts);
+  auto ndsts = destinations.size();
+  auto t0 = now();
+  std::vector<MPI_Request> sendreqs(static_cast<std::size_t>(ndsts));
+  for (LO i = 0; i < ndsts; ++i) {
+    CALL(MPI_Issend(counts.data() + i, 1, MpiTraits<LO>::datatype(),
+        destinations[i], tag, impl_, &sendreqs[std::size_t(i)]));
+  }
+  std::vector<std::pair<I32, LO>> recvd;
+  MPI_Request barrier_req;
+  bool in_barrier = false;
+  while (true) {
+    int has_msg;
+    MPI_Status status;
+    CALL(MPI_Iprobe(MPI_ANY_SOURCE, tag, impl_, &has_msg, &status));
+    if (has_msg) {
+      LO count;
+      CALL(MPI_Recv(&count, 1, MpiTraits<LO>::datatype(), status.MPI_SOURCE,
+          tag, impl_, MPI_STATUS_IGNORE));
+      recvd.push_back(std::make_pair(I32(status.MPI_SOURCE), count));
+    }
+    if (in_barrier) {
+      int done;
+      CALL(MPI_Test(&barrier_req, &done, MPI_STATUS_IGNORE));
+      if (done) break;
+    } else {
+      int sent;
+      CALL(MPI_Testall(ndsts, sendreqs.data(), &sent, MPI_STATUSES_IGNORE));
+      if (sent) {
+        CALL(MPI_Ibarrier(impl_, &barrier_req));
+        in_barrier = true;
+      }
+    }
+  }
+  std::sort(recvd.begin(), recvd.end());
+  auto nsrcs = LO(recvd.size());
+  HostWrite<I32> sources(nsrcs);
+  HostWrite<LO> src_counts(nsrcs);
+  for (LO i = 0; i < nsrcs; ++i) {
+    sources[i] = recvd[std::size_t(i)].first;
+    src_counts[i] = recvd[std::size_t(i)].second;
+  }
+  record_neighbor_exch(rank(), HostRead<I32>(sources.write()), destinations,
+      I64(sizeof(LO)), t0);
+  *p_srcs = sources.write();
+  *p_src_counts = src_counts.write();
+#endif
+#else
+  *p_srcs = dsts;
+  *p_src_counts = dst_counts;
+#endif
+}
+
 template <typename T>
 T Comm::allreduce(T x, Omega_h_Op op) const {
 #ifdef OMEGA_H_USE_MPI
+  auto t0 = now();
   CALL(MPI_Allreduce(
       MPI_IN_PLACE, &x, 1, MpiTraits<T>::datatype(), mpi_op(op), impl_));
+  record_collective(I64(sizeof(T)), t0);
 #else
   (void)op;
 #endif
   return x;
 }
 
+#ifdef OMEGA_H_USE_MPI
+/* each value travels with its operation so that a single
+   user-defined MPI_Op can apply a different reduction
+   to each entry of the batch */
+template <typename T>
+struct BatchItem {
+  T value;
+  I32 op;
+};
+
+template <typename T>
+static void mpi_reduce_batch(void* a, void* b, int* len, MPI_Datatype* type) {
+  int type_size;
+  CALL(MPI_Type_size(*type, &type_size));
+  auto n = (*len) * type_size / int(sizeof(BatchItem<T>));
+  BatchItem<T>* a2 = static_cast<BatchItem<T>*>(a);
+  BatchItem<T>* b2 = static_cast<BatchItem<T>*>(b);
+  for (int i = 0; i < n; ++i) {
+    switch (b2[i].op) {
+      case OMEGA_H_MIN:
+        b2[i].value = min2(a2[i].value, b2[i].value);
+        break;
+      case OMEGA_H_MAX:
+        b2[i].value = max2(a2[i].value, b2[i].value);
+        break;
+      case OMEGA_H_SUM:
+        b2[i].value = static_cast<T>(a2[i].value + b2[i].value);
+        break;
+    }
+  }
+}
+#endif
+
+template <typename T>
+std::vector<T> Comm::allreduce(
+    std::vector<T> const& x, std::vector<Omega_h_Op> const& ops) const {
+  CHECK(x.size() == ops.size());
+#ifdef OMEGA_H_USE_MPI
+  if (x.empty()) return x;
+  std::vector<BatchItem<T>> items(x.size());
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    items[i].value = x[i];
+    items[i].op = ops[i];
+  }
+  /* the whole batch is one element of a contiguous datatype,
+     so the MPI implementation can't split it between calls
+     to the reduction function */
+  MPI_Datatype type;
+  CALL(MPI_Type_contiguous(
+      int(items.size() * sizeof(BatchItem<T>)), MPI_BYTE, &type));
+  CALL(MPI_Type_commit(&type));
+  MPI_Op op;
+  int commute = true;
+  CALL(MPI_Op_create(mpi_reduce_batch<T>, commute, &op));
+  auto t0 = now();
+  CALL(MPI_Allreduce(MPI_IN_PLACE, items.data(), 1, type, op, impl_));
+  record_collective(I64(items.size() * sizeof(BatchItem<T>)), t0);
+  CALL(MPI_Op_free(&op));
+  CALL(MPI_Type_free(&type));
+  std::vector<T> out(x.size());
+  for (std::size_t i = 0; i < x.size(); ++i) out[i] = items[i].value;
+  return out;
+#else
+  return x;
+#endif
+}
+
 bool Comm::reduce_or(bool x) const {
   I8 y = x;
   y = allreduce(y, OMEGA_H_MAX);
@@ -192,7 +503,9 @@ Int128 Comm::add_int128(Int128 x) const {
   MPI_Op op;
   int commute = true;
   CALL(MPI_Op_create(mpi_add_int128, commute, &op));
+  auto t0 = now();
   CALL(MPI_Allreduce(MPI_IN_PLACE, &x, sizeof(Int128), MPI_PACKED, op, impl_));
+  record_collective(I64(sizeof(Int128)), t0);
   CALL(MPI_Op_free(&op));
 #endif
   return x;
@@ -201,8 +514,10 @@ Int128 Comm::add_int128(Int128 x) const {
 template <typename T>
 T Comm::exscan(T x, Omega_h_Op op) const {
 #ifdef OMEGA_H_USE_MPI
+  auto t0 = now();
   CALL(MPI_Exscan(
       MPI_IN_PLACE, &x, 1, MpiTraits<T>::datatype(), mpi_op(op), impl_));
+  record_collective(I64(sizeof(T)), t0);
   if (rank() == 0) x = 0;
   return x;
 #else
@@ -215,7 +530,9 @@ T Comm::exscan(T x, Omega_h_Op op) const {
 template <typename T>
 void Comm::bcast(T& x) const {
 #ifdef OMEGA_H_USE_MPI
+  auto t0 = now();
   CALL(MPI_Bcast(&x, 1, MpiTraits<T>::datatype(), 0, impl_));
+  record_collective(I64(sizeof(T)), t0);
 #else
   (void)x;
 #endif
@@ -226,7 +543,9 @@ void Comm::bcast_string(std::string& s) const {
   I32 len = static_cast<I32>(s.length());
   bcast(len);
   s.resize(static_cast<std::size_t>(len));
+  auto t0 = now();
   CALL(MPI_Bcast(&s[0], len, MPI_CHAR, 0, impl_));
+  record_collective(I64(len), t0);
 #else
   (void)s;
 #endif
@@ -310,33 +629,30 @@ static int Neighbor_alltoall(HostRead<I32> sources, HostRead<I32> destinations,
 #endif  // end if MPI_VERSION < 3
 }
 
-/* custom implementation of MPI_Neighbor_alltoallv
+/* custom implementation of MPI_Neighbor_alltoallw
  * in the case that we are using an MPI older
  * than version 3.0
  */
 
-static int Neighbor_alltoallv(HostRead<I32> sources, HostRead<I32> destinations,
-    const void* sendbuf, const int sendcounts[], const int sdispls[],
-    MPI_Datatype sendtype, void* recvbuf, const int recvcounts[],
-    const int rdispls[], MPI_Datatype recvtype, MPI_Comm comm) {
+static int Neighbor_alltoallw(HostRead<I32> sources, HostRead<I32> destinations,
+    const void* sendbuf, const int sendcounts[], const MPI_Aint sdispls[],
+    const MPI_Datatype sendtypes[], void* recvbuf, const int recvcounts[],
+    const MPI_Aint rdispls[], const MPI_Datatype recvtypes[], MPI_Comm comm) {
 #if MPI_VERSION < 3
   static int const tag = 42;
   int indegree, outdegree;
   indegree = sources.size();
   outdegree = destinations.size();
-  int sendwidth;
-  CALL(MPI_Type_size(sendtype, &sendwidth));
-  int recvwidth;
-  CALL(MPI_Type_size(sendtype, &recvwidth));
   MPI_Request* recvreqs = new MPI_Request[indegree];
   MPI_Request* sendreqs = new MPI_Request[outdegree];
   for (int i = 0; i < indegree; ++i)
-    CALL(MPI_Irecv(static_cast<char*>(recvbuf) + rdispls[i] * recvwidth,
-        recvcounts[i], recvtype, sources[i], tag, comm, recvreqs + i));
+    CALL(MPI_Irecv(static_cast<char*>(recvbuf) + rdispls[i], recvcounts[i],
+        recvtypes[i], sources[i], tag, comm, recvreqs + i));
   CALL(MPI_Barrier(comm));
   for (int i = 0; i < outdegree; ++i)
-    CALL(MPI_Isend(static_cast<char const*>(sendbuf) + sdispls[i] * sendwidth,
-        sendcounts[i], sendtype, destinations[i], tag, comm, sendreqs + i));
+    CALL(MPI_Isend(static_cast<char const*>(sendbuf) + sdispls[i],
+        sendcounts[i], sendtypes[i], destinations[i], tag, comm,
+        sendreqs + i));
   CALL(MPI_Waitall(outdegree, sendreqs, MPI_STATUSES_IGNORE));
   delete[] sendreqs;
   CALL(MPI_Waitall(indegree, recvreqs, MPI_STATUSES_IGNORE));
@@ -345,20 +661,70 @@ static int Neighbor_alltoallv(HostRead<I32> sources, HostRead<I32> destinations,
 #else
   (void)sources;
   (void)destinations;
-  return MPI_Neighbor_alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf,
-      recvcounts, rdispls, recvtype, comm);
+  return MPI_Neighbor_alltoallw(sendbuf, sendcounts, sdispls, sendtypes,
+      recvbuf, recvcounts, rdispls, recvtypes, comm);
 #endif  // end if MPI_VERSION < 3
 }
 
+/* MPI counts are int, and some implementations also compute
+   message sizes in bytes using int.
+   any message larger than max_message_bytes() is described
+   by a single derived datatype made of large contiguous
+   blocks plus a remainder, so its count is one.
+   displacements are in bytes, using 64-bit MPI_Aint. */
+struct MessageTypes {
+  std::vector<int> counts;
+  std::vector<MPI_Aint> displs;
+  std::vector<MPI_Datatype> types;
+  std::vector<MPI_Datatype> derived;
+  MessageTypes(HostRead<LO> elem_counts, HostRead<LO> elem_displs,
+      MPI_Datatype base, I64 base_size) {
+    auto n = elem_counts.size();
+    counts.resize(std::size_t(n));
+    displs.resize(std::size_t(n));
+    types.resize(std::size_t(n));
+    auto block_elems = max2(message_bytes_limit / base_size, I64(1));
+    for (LO i = 0; i < n; ++i) {
+      auto ui = std::size_t(i);
+      I64 nelems = elem_counts[i];
+      displs[ui] = MPI_Aint(I64(elem_displs[i]) * base_size);
+      if (nelems * base_size <= message_bytes_limit) {
+        counts[ui] = int(nelems);
+        types[ui] = base;
+        continue;
+      }
+      auto nblocks = nelems / block_elems;
+      auto nrest = nelems % block_elems;
+      MPI_Datatype block;
+      CALL(MPI_Type_contiguous(int(block_elems), base, &block));
+      int blocklens[2] = {int(nblocks), int(nrest)};
+      MPI_Aint offsets[2] = {0, MPI_Aint(nblocks * block_elems * base_size)};
+      MPI_Datatype parts[2] = {block, base};
+      MPI_Datatype message;
+      CALL(MPI_Type_create_struct(2, blocklens, offsets, parts, &message));
+      CALL(MPI_Type_commit(&message));
+      CALL(MPI_Type_free(&block));
+      counts[ui] = 1;
+      types[ui] = message;
+      derived.push_back(message);
+    }
+  }
+  ~MessageTypes() {
+    for (auto& type : derived) CALL(MPI_Type_free(&type));
+  }
+};
+
 #endif  // end ifdef OMEGA_H_USE_MPI
 
 template <typename T>
 Read<T> Comm::allgather(T x) const {
 #ifdef OMEGA_H_USE_MPI
   HostWrite<T> recvbuf(srcs_.size());
+  auto t0 = now();
   CALL(Neighbor_allgather(host_srcs_, host_dsts_, &x, 1,
       MpiTraits<T>::datatype(), recvbuf.data(), 1, MpiTraits<T>::datatype(),
       impl_));
+  record_neighbor_exch(rank(), host_srcs_, host_dsts_, I64(sizeof(T)), t0);
   return recvbuf.write();
 #else
   if (srcs_.size() == 1) return Read<T>({x});
@@ -371,9 +737,11 @@ Read<T> Comm::alltoall(Read<T> x) const {
 #ifdef OMEGA_H_USE_MPI
   HostWrite<T> recvbuf(srcs_.size());
   HostRead<T> sendbuf(x);
+  auto t0 = now();
   CALL(Neighbor_alltoall(host_srcs_, host_dsts_, sendbuf.data(), 1,
       MpiTraits<T>::datatype(), recvbuf.data(), 1, MpiTraits<T>::datatype(),
       impl_));
+  record_neighbor_exch(rank(), host_srcs_, host_dsts_, I64(sizeof(T)), t0);
   return recvbuf.write();
 #else
   return x;
@@ -396,10 +764,23 @@ Read<T> Comm::alltoallv(Read<T> sendbuf_dev, Read<LO> sendcounts_dev,
   CHECK(recvcounts.size() == host_srcs_.size());
   CHECK(sdispls.size() == sendcounts.size() + 1);
   CHECK(sendbuf.size() == sdispls.last());
-  CALL(Neighbor_alltoallv(host_srcs_, host_dsts_, sendbuf.data(),
-      sendcounts.data(), sdispls.data(), MpiTraits<T>::datatype(),
-      recvbuf.data(), recvcounts.data(), rdispls.data(),
-      MpiTraits<T>::datatype(), impl_));
+  auto type = MpiTraits<T>::datatype();
+  auto sends = MessageTypes(sendcounts, sdispls, type, I64(sizeof(T)));
+  auto recvs = MessageTypes(recvcounts, rdispls, type, I64(sizeof(T)));
+  auto t0 = now();
+  CALL(Neighbor_alltoallw(host_srcs_, host_dsts_, sendbuf.data(),
+      sends.counts.data(), sends.displs.data(), sends.types.data(),
+      recvbuf.data(), recvs.counts.data(), recvs.displs.data(),
+      recvs.types.data(), impl_));
+  auto self = rank();
+  Traffic sent, recvd;
+  for (LO i = 0; i < host_dsts_.size(); ++i) {
+    sent.add(self, host_dsts_[i], I64(sendcounts[i]) * I64(sizeof(T)));
+  }
+  for (LO i = 0; i < host_srcs_.size(); ++i) {
+    recvd.add(self, host_srcs_[i], I64(recvcounts[i]) * I64(sizeof(T)));
+  }
+  record_neighbor_exch(sent, recvd, t0);
   return recvbuf.write();
 #else
   (void)sendcounts_dev;
@@ -410,9 +791,18 @@ Read<T> Comm::alltoallv(Read<T> sendbuf_dev, Read<LO> sendcounts_dev,
 #endif
 }
 
+I64 max_message_bytes() { return message_bytes_limit; }
+
+void set_max_message_bytes(I64 nbytes) {
+  CHECK(nbytes > 0);
+  message_bytes_limit = nbytes;
+}
+
 void Comm::barrier() const {
 #ifdef OMEGA_H_USE_MPI
+  auto t0 = now();
   CALL(MPI_Barrier(impl_));
+  record_collective(0, t0);
 #endif
 }
 
@@ -420,6 +810,8 @@ void Comm::barrier() const {
 
 #define INST(T)                                                                \
   template T Comm::allreduce(T x, Omega_h_Op op) const;                        \
+  template std::vector<T> Comm::allreduce(                                     \
+      std::vector<T> const& x, std::vector<Omega_h_Op> const& ops) const;      \
   template T Comm::exscan(T x, Omega_h_Op op) const;                           \
   template void Comm::bcast(T& x) const;                                       \
   template Read<T> Comm::allgather(T x) const;                                 \
@@ -47,6 +47,11 @@ struct MpiTraits<double> {
 
 static_assert(sizeof(int) == 4, "Comm assumes 32-bit int");
 
+/* messages larger than this many bytes are sent using
+   derived datatypes instead of plain element counts */
+I64 max_message_bytes();
+void set_max_message_bytes(I64 nbytes);
+
 #ifdef OMEGA_H_USE_MPI
 inline MPI_Op mpi_op(Omega_h_Op op) {
   switch (op) {
@@ -0,0 +1,107 @@
+#include "comm_stats.hpp"
+
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace Omega_h {
+
+CommStats::CommStats()
+    : ncalls(0),
+      nmsgs_sent(0),
+      nmsgs_recvd(0),
+      bytes_sent(0),
+      bytes_recvd(0),
+      max_neighbors(0),
+      blocked_time(0.0) {}
+
+static std::vector<std::string> phase_stack;
+static std::map<std::string, CommStats> phase_stats;
+static bool report_at_exit = false;
+
+CommPhase::CommPhase(std::string const& name) { phase_stack.push_back(name); }
+
+CommPhase::~CommPhase() { phase_stack.pop_back(); }
+
+void record_comm(I64 nmsgs_sent, I64 bytes_sent, I64 nmsgs_recvd,
+    I64 bytes_recvd, I32 nneighbors, Real blocked_time) {
+  /* the innermost phase is charged, so that for example the
+     migration done while ghosting counts as migration */
+  auto name = phase_stack.empty() ? std::string("other") : phase_stack.back();
+  auto& stats = phase_stats[name];
+  ++stats.ncalls;
+  stats.nmsgs_sent += nmsgs_sent;
+  stats.nmsgs_recvd += nmsgs_recvd;
+  stats.bytes_sent += bytes_sent;
+  stats.bytes_recvd += bytes_recvd;
+  stats.max_neighbors = max2(stats.max_neighbors, nneighbors);
+  stats.blocked_time += blocked_time;
+}
+
+std::vector<std::string> get_comm_phases() {
+  std::vector<std::string> names;
+  for (auto& pair : phase_stats) names.push_back(pair.first);
+  return names;
+}
+
+CommStats get_comm_stats(std::string const& phase) {
+  auto it = phase_stats.find(phase);
+  if (it == phase_stats.end()) return CommStats();
+  return it->second;
+}
+
+void reset_comm_stats() { phase_stats.clear(); }
+
+void print_comm_stats(CommPtr comm, std::ostream& stream) {
+  /* ranks normally see the same phases, but to be safe
+     we report the phases known to rank 0 */
+  std::stringstream names_stream;
+  for (auto& name : get_comm_phases()) names_stream << name << '\n';
+  auto names_string = names_stream.str();
+  comm->bcast_string(names_string);
+  names_stream.str(names_string);
+  std::vector<std::string> names;
+  std::string name;
+  while (std::getline(names_stream, name)) names.push_back(name);
+  std::vector<I64> counts;
+  std::vector<Omega_h_Op> count_ops;
+  std::vector<Real> times;
+  std::vector<Omega_h_Op> time_ops;
+  for (auto& phase : names) {
+    auto stats = get_comm_stats(phase);
+    counts.insert(counts.end(),
+        {stats.ncalls, stats.nmsgs_sent, stats.nmsgs_sent, stats.nmsgs_recvd,
+            stats.nmsgs_recvd, stats.bytes_sent, stats.bytes_sent,
+            stats.bytes_recvd, stats.bytes_recvd,
+            I64(stats.max_neighbors)});
+    count_ops.insert(count_ops.end(),
+        {OMEGA_H_MAX, OMEGA_H_SUM, OMEGA_H_MAX, OMEGA_H_SUM, OMEGA_H_MAX,
+            OMEGA_H_SUM, OMEGA_H_MAX, OMEGA_H_SUM, OMEGA_H_MAX,
+            OMEGA_H_MAX});
+    times.insert(times.end(), {stats.blocked_time, stats.blocked_time});
+    time_ops.insert(time_ops.end(), {OMEGA_H_SUM, OMEGA_H_MAX});
+  }
+  counts = comm->allreduce(counts, count_ops);
+  times = comm->allreduce(times, time_ops);
+  if (comm->rank() != 0) return;
+  auto nranks = comm->size();
+  stream << "communication by phase (average / maximum over "
+         << nranks << " ranks):\n";
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    auto c = &counts[i * 10];
+    auto t = &times[i * 2];
+    stream << names[i] << ": " << c[0] << " calls, ";
+    stream << Real(c[1]) / nranks << " / " << c[2] << " messages sent, ";
+    stream << Real(c[3]) / nranks << " / " << c[4] << " messages received, ";
+    stream << Real(c[5]) / nranks << " / " << c[6] << " bytes sent, ";
+    stream << Real(c[7]) / nranks << " / " << c[8] << " bytes received, ";
+    stream << c[9] << " max neighbors, ";
+    stream << t[0] / nranks << " / " << t[1] << " seconds blocked\n";
+  }
+}
+
+void report_comm_stats_at_exit(bool yn) { report_at_exit = yn; }
+
+bool reports_comm_stats_at_exit() { return report_at_exit; }
+
+}  // end namespace Omega_h
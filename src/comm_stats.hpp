@@ -0,0 +1,18 @@
+#ifndef COMM_STATS_HPP
+#define COMM_STATS_HPP
+
+#include "internal.hpp"
+
+namespace Omega_h {
+
+/* called by Comm after each communication call to charge it
+   to the current phase. messages between a rank and itself
+   are local copies and should not be included. */
+void record_comm(I64 nmsgs_sent, I64 bytes_sent, I64 nmsgs_recvd,
+    I64 bytes_recvd, I32 nneighbors, Real blocked_time);
+
+bool reports_comm_stats_at_exit();
+
+}  // end namespace Omega_h
+
+#endif
@@ -46,6 +46,13 @@ void build_from_elems2verts(
   mesh->set_comm(comm);
   mesh->set_parting(OMEGA_H_ELEM_BASED);
   mesh->set_dim(edim);
+  build_ents_from_elems2verts(mesh, ev2v, vert_globals);
+}
+
+void build_ents_from_elems2verts(
+    Mesh* mesh, LOs ev2v, Read<GO> vert_globals) {
+  auto comm = mesh->comm();
+  auto edim = mesh->dim();
   auto nverts = vert_globals.size();
   mesh->set_verts(nverts);
   mesh->add_tag(
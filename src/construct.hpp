@@ -6,6 +6,9 @@
 namespace Omega_h {
 
 void add_ents2verts(Mesh* mesh, Int edim, LOs ev2v, Read<GO> vert_globals);
+/* the part of build_from_elems2verts() after the communicator,
+   parting and dimension of (mesh) are set */
+void build_ents_from_elems2verts(Mesh* mesh, LOs ev2v, Read<GO> vert_globals);
 void resolve_derived_copies(CommPtr comm, Read<GO> verts2globs, Int deg,
     LOs* p_ent_verts2verts, Remotes* p_ents2owners);
 
@@ -2,8 +2,11 @@
 #include "protect.hpp"
 
 #include <cstdarg>
+#include <iostream>
 #include <sstream>
 
+#include "comm_stats.hpp"
+
 namespace Omega_h {
 
 #ifdef OMEGA_H_USE_MPI
@@ -79,7 +82,10 @@ extern "C" void Omega_h_fail(char const* format, ...) {
 #pragma clang diagnostic pop
 #endif
 
-Library::~Library() { Omega_h_finalize(); }
+Library::~Library() {
+  if (reports_comm_stats_at_exit()) print_comm_stats(world(), std::cout);
+  Omega_h_finalize();
+}
 
 CommPtr Library::world() const { return Comm::world(); }
 
@@ -55,11 +55,20 @@ void Dist::set_dest_ranks(Read<I32> items2ranks) {
   parallel_for(jumps.size(), log_ends);
   items2content_[F] = invert_permutation(content2items);
   msgs2content_[F] = msgs2content;
-  comm_[F] = parent_comm_->graph(msgs2ranks);
-  comm_[R] = comm_[F]->graph_inverse();
   auto fdegrees = get_degrees(msgs2content_[F]);
-  auto rdegrees = comm_[F]->alltoall(fdegrees);
-  msgs2content_[R] = offset_scan(rdegrees);
+  if (parent_comm_->uses_nbx()) {
+    Read<I32> srcs;
+    Read<LO> rdegrees;
+    parent_comm_->find_sources(msgs2ranks, fdegrees, &srcs, &rdegrees);
+    parent_comm_->graph_pair(srcs, msgs2ranks, &comm_[F], &comm_[R]);
+    msgs2content_[R] = offset_scan(rdegrees);
+  } else {
+    comm_[F] = parent_comm_->graph(msgs2ranks);
+    comm_[R] = parent_comm_->graph_adjacent(
+        comm_[F]->destinations(), comm_[F]->sources());
+    auto rdegrees = comm_[F]->alltoall(fdegrees);
+    msgs2content_[R] = offset_scan(rdegrees);
+  }
 }
 
 void Dist::set_dest_idxs(LOs fitems2rroots, LO nrroots) {
@@ -158,8 +167,7 @@ void Dist::change_comm(CommPtr new_comm) {
   auto new_sources = comm_[F]->allgather(new_comm->rank());
   auto new_destinations = comm_[R]->allgather(new_comm->rank());
   // rebuild graph communicators from these new neighbor lists
-  comm_[F] = new_comm->graph_adjacent(new_sources, new_destinations);
-  comm_[R] = comm_[F]->graph_inverse();
+  new_comm->graph_pair(new_sources, new_destinations, &comm_[F], &comm_[R]);
   // replace parent_comm_
   parent_comm_ = new_comm;
   // thats it! since all rank information is queried from graph comms
@@ -12,10 +12,9 @@ int main(int argc, char** argv) {
   mesh.keep_canonical_globals(false);
   mesh.add_tag<Real>(VERT, "size", 1, OMEGA_H_LINEAR_INTERP, OMEGA_H_DO_OUTPUT);
   Now t0 = now();
-  Int i = 0;
-  do {
-    Write<Real> size(mesh.nverts());
-    auto coords = mesh.coords();
+  mesh.set_tag_function("size", [](Reals coords) {
+    auto npts = coords.size() / 2;
+    Write<Real> size(npts);
     auto f = LAMBDA(LO v) {
       auto x = get_vector<2>(coords, v);
       auto s = cos(x[0] * 8.0 * M_PI) / 4.0 + 1.0 / 2.0;
@@ -24,8 +23,11 @@ int main(int argc, char** argv) {
       auto length = sqrt(2 * area);
       size[v] = length;
     };
-    parallel_for(mesh.nverts(), f);
-    mesh.set_tag(VERT, "size", Reals(size));
+    parallel_for(npts, f);
+    return Reals(size);
+  });
+  Int i = 0;
+  do {
     ++i;
   } while (refine_by_size(&mesh, 1.5, 0.47, true));
   Now t1 = now();
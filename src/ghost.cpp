@@ -1,9 +1,11 @@
 #include "ghost.hpp"
 
+#include "array.hpp"
 #include "loop.hpp"
 #include "map.hpp"
 #include "migrate.hpp"
 #include "remotes.hpp"
+#include "simplices.hpp"
 
 namespace Omega_h {
 
@@ -31,6 +33,21 @@ void get_own_verts2own_elem_uses(
   own_verts2serv_uses = own_verts2local_uses.roots2items();
 }
 
+/* same as above, but only for uses of the marked vertices */
+static void get_own_verts2own_elem_uses(Mesh* mesh, Read<I8> verts_are_centers,
+    Remotes& serv_uses2own_elems, LOs& own_verts2serv_uses) {
+  auto verts2uses = mesh->ask_up(VERT, mesh->dim()).a2ab;
+  auto uses_are_kept = expand(verts_are_centers, verts2uses, 1);
+  auto kept2uses = collect_marked(uses_are_kept);
+  auto kept2own_elems =
+      unmap(kept2uses, get_local_elem_uses2own_elems(mesh));
+  auto kept2own_verts =
+      unmap(kept2uses, expand(mesh->ask_owners(VERT), verts2uses));
+  Dist kept2own_verts_dist(mesh->comm(), kept2own_verts, mesh->nverts());
+  serv_uses2own_elems = kept2own_verts_dist.exch(kept2own_elems, 1);
+  own_verts2serv_uses = kept2own_verts_dist.invert().roots2items();
+}
+
 Remotes push_elem_uses(Remotes serv_uses2own_elems, LOs own_verts2serv_uses,
     Dist own_verts2verts) {
   auto nown_verts = own_verts2verts.nroots();
@@ -67,19 +84,98 @@ Remotes push_elem_uses(Remotes serv_uses2own_elems, LOs own_verts2serv_uses,
   return items2verts.exch(items2own_elems, 1);
 }
 
-void ghost_mesh(Mesh* mesh, bool verbose) {
+static Remotes concat(Remotes a, Remotes b) {
+  auto na = a.ranks.size();
+  auto nb = b.ranks.size();
+  Write<I32> ranks(na + nb);
+  Write<LO> idxs(na + nb);
+  map_into(a.ranks, LOs(na, 0, 1), ranks, 1);
+  map_into(a.idxs, LOs(na, 0, 1), idxs, 1);
+  map_into(b.ranks, LOs(nb, na, 1), ranks, 1);
+  map_into(b.idxs, LOs(nb, na, 1), idxs, 1);
+  return Remotes(Read<I32>(ranks), LOs(idxs));
+}
+
+/* given the ranks each element is copied to, push the uses of the
+   vertices of those copies to the same ranks, adding one layer */
+static Dist add_ghost_layer(Mesh* mesh, Dist own_elems2elems,
+    Remotes serv_uses2own_elems, LOs own_verts2serv_uses) {
+  auto comm = mesh->comm();
+  auto nverts_per_elem = simplex_degrees[mesh->dim()][VERT];
+  auto elem_verts2own_verts =
+      unmap(mesh->ask_elem_verts(), mesh->ask_owners(VERT));
+  auto copy_verts2own_verts =
+      own_elems2elems.exch(elem_verts2own_verts, nverts_per_elem);
+  auto copy_verts2own_verts_dist =
+      Dist(comm, copy_verts2own_verts, mesh->nverts());
+  auto own_verts2ranks = find_unique_use_owners(copy_verts2own_verts_dist);
+  auto own_verts2dests = own_verts2ranks.roots2items();
+  auto dests2ranks = own_verts2ranks.items2ranks();
+  auto own_verts2items = multiply_fans(own_verts2serv_uses, own_verts2dests);
+  auto nitems = own_verts2items.last();
+  Write<I32> elem_ranks(nitems);
+  Write<LO> elem_idxs(nitems);
+  Write<I32> dest_ranks(nitems);
+  auto f = LAMBDA(LO ov) {
+    auto item = own_verts2items[ov];
+    for (auto d = own_verts2dests[ov]; d < own_verts2dests[ov + 1]; ++d) {
+      for (auto su = own_verts2serv_uses[ov]; su < own_verts2serv_uses[ov + 1];
+           ++su) {
+        elem_ranks[item] = serv_uses2own_elems.ranks[su];
+        elem_idxs[item] = serv_uses2own_elems.idxs[su];
+        dest_ranks[item] = dests2ranks[d];
+        ++item;
+      }
+    }
+  };
+  parallel_for(mesh->nverts(), f);
+  Dist items2dests;
+  items2dests.set_parent_comm(comm);
+  items2dests.set_dest_ranks(dest_ranks);
+  auto items2own_elems = Remotes(Read<I32>(elem_ranks), LOs(elem_idxs));
+  auto elem_uses = items2dests.exch(items2own_elems, 1);
+  return find_unique_use_owners(Dist(comm, elem_uses, mesh->nelems()));
+}
+
+static void ghost_by_uses(Mesh* mesh, Remotes elem_uses, Int nlayers,
+    Remotes serv_uses2own_elems, LOs own_verts2serv_uses, bool verbose) {
+  auto uses2old_owners = Dist(mesh->comm(), elem_uses, mesh->nelems());
+  auto own_elems2elems = find_unique_use_owners(uses2old_owners);
+  for (Int layer = 1; layer < nlayers; ++layer) {
+    own_elems2elems = add_ghost_layer(
+        mesh, own_elems2elems, serv_uses2own_elems, own_verts2serv_uses);
+  }
+  auto elems2owners = own_elems2elems.invert();
+  auto new_mesh = mesh->copy_meta();
+  migrate_mesh_delta(mesh, &new_mesh, elems2owners, OMEGA_H_GHOSTED, verbose);
+  *mesh = new_mesh;
+}
+
+void ghost_mesh(Mesh* mesh, bool verbose) { ghost_mesh(mesh, 1, verbose); }
+
+void ghost_mesh(Mesh* mesh, Int nlayers, bool verbose) {
+  CHECK(nlayers >= 1);
   Remotes own_vert_uses2own_elems;
   LOs own_verts2own_vert_uses;
   get_own_verts2own_elem_uses(
       mesh, own_vert_uses2own_elems, own_verts2own_vert_uses);
   auto elem_uses = push_elem_uses(own_vert_uses2own_elems,
       own_verts2own_vert_uses, mesh->ask_dist(VERT).invert());
-  auto uses2old_owners = Dist(mesh->comm(), elem_uses, mesh->nelems());
-  auto own_elems2elems = find_unique_use_owners(uses2old_owners);
-  auto elems2owners = own_elems2elems.invert();
-  auto new_mesh = mesh->copy_meta();
-  migrate_mesh(mesh, &new_mesh, elems2owners, OMEGA_H_GHOSTED, verbose);
-  *mesh = new_mesh;
+  ghost_by_uses(mesh, elem_uses, nlayers, own_vert_uses2own_elems,
+      own_verts2own_vert_uses, verbose);
+}
+
+void ghost_mesh(Mesh* mesh, Read<I8> verts_are_centers, bool verbose) {
+  Remotes own_vert_uses2own_elems;
+  LOs own_verts2own_vert_uses;
+  get_own_verts2own_elem_uses(mesh, verts_are_centers,
+      own_vert_uses2own_elems, own_verts2own_vert_uses);
+  auto elem_uses = push_elem_uses(own_vert_uses2own_elems,
+      own_verts2own_vert_uses, mesh->ask_dist(VERT).invert());
+  /* elements that use no marked vertex still stay where they are */
+  elem_uses = concat(elem_uses, mesh->ask_owners(mesh->dim()));
+  ghost_by_uses(mesh, elem_uses, 1, own_vert_uses2own_elems,
+      own_verts2own_vert_uses, verbose);
 }
 
 void partition_by_verts(Mesh* mesh, bool verbose) {
@@ -92,7 +188,8 @@ void partition_by_verts(Mesh* mesh, bool verbose) {
   auto own_elems2elems = find_unique_use_owners(uses2old_owners);
   auto elems2owners = own_elems2elems.invert();
   auto new_mesh = mesh->copy_meta();
-  migrate_mesh(mesh, &new_mesh, elems2owners, OMEGA_H_VERT_BASED, verbose);
+  migrate_mesh_delta(
+      mesh, &new_mesh, elems2owners, OMEGA_H_VERT_BASED, verbose);
   *mesh = new_mesh;
 }
 
@@ -102,7 +199,7 @@ void partition_by_elems(Mesh* mesh, bool verbose) {
   auto marked_owned = mesh->owned(dim);
   auto owned2all = collect_marked(marked_owned);
   auto owned2owners = unmap(owned2all, all2owners);
-  migrate_mesh(mesh, owned2owners, verbose);
+  migrate_mesh_delta(mesh, owned2owners, verbose);
 }
 
 }  // end namespace Omega_h
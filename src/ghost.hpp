@@ -13,6 +13,14 @@ Remotes push_elem_uses(
     Remotes serv_uses2own_elems, LOs own_verts2serv_uses, Dist own_verts2verts);
 
 void ghost_mesh(Mesh* mesh, bool verbose);
+/* each rank gets (nlayers) layers of elements around its own ones,
+   by pushing vertex uses out to the previous layer's ranks */
+void ghost_mesh(Mesh* mesh, Int nlayers, bool verbose);
+/* ghosts only the elements around the marked vertices, which must
+   be marked consistently on all their copies. each rank keeps its
+   own elements and gets every element adjacent to a marked vertex
+   it has a copy of */
+void ghost_mesh(Mesh* mesh, Read<I8> verts_are_centers, bool verbose);
 void partition_by_verts(Mesh* mesh, bool verbose);
 void partition_by_elems(Mesh* mesh, bool verbose);
 
@@ -1,7 +1,11 @@
 #include "hilbert.hpp"
 
+#include <algorithm>
+
+#include "array.hpp"
 #include "bbox.hpp"
 #include "loop.hpp"
+#include "map.hpp"
 #include "sort.hpp"
 
 namespace Omega_h {
@@ -20,6 +24,20 @@ namespace hilbert {
    among the integers, with the first integer getting the most significant
    bits, and the last integer getting the least significant bits. */
 
+INLINE coord_t to_grid(Real coord, Real min, Real maxl, Int nbits) {
+  /* floating-point coordinate to fine-grid integer coordinate,
+     should be non-negative since we subtract the BBox min */
+  Real zero_to_one_coord = (coord - min) / maxl;
+  Real zero_to_2eP_coord = zero_to_one_coord * exp2(Real(nbits));
+  auto x = coord_t(zero_to_2eP_coord);
+  /* some values will just graze the acceptable range
+     (with proper floating point math they are exactly
+      equal to 2^(nbits), and we'll be safe with (>=) in case
+     floating point math is even worse than that. */
+  if (x >= (coord_t(1) << nbits)) x = (coord_t(1) << nbits) - 1;
+  return x;
+}
+
 template <Int dim>
 static Read<I64> dists_from_coords_dim(Reals coords) {
   auto bbox = find_bounding_box<dim>(coords);
@@ -31,18 +49,7 @@ static Read<I64> dists_from_coords_dim(Reals coords) {
     hilbert::coord_t X[dim];
     Int nbits = MANTISSA_BITS;
     for (Int j = 0; j < dim; ++j) {
-      /* floating-point coordinate to fine-grid integer coordinate,
-         should be non-negative since we subtract the BBox min */
-      Real coord = coords[i * dim + j];
-      Real zero_to_one_coord = (coord - bbox.min[j]) / maxl;
-      Real zero_to_2eP_coord = zero_to_one_coord * exp2(Real(nbits));
-      X[j] = hilbert::coord_t(zero_to_2eP_coord);
-      /* some values will just graze the acceptable range
-         (with proper floating point math they are exactly
-          equal to 2^(nbits), and we'll be safe with (>=) in case
-         floating point math is even worse than that. */
-      if (X[j] >= (hilbert::coord_t(1) << nbits))
-        X[j] = (hilbert::coord_t(1) << nbits) - 1;
+      X[j] = to_grid(coords[i * dim + j], bbox.min[j], maxl, nbits);
     }
     hilbert::AxestoTranspose(X, nbits, dim);
     hilbert::coord_t Y[dim];
@@ -65,6 +72,213 @@ LOs sort_coords(Reals coords, Int dim) {
   return sort_by_keys(keys, dim);
 }
 
+/* the number of bits per axis of the coarser grid used when
+   the whole Hilbert distance, as well as one past the largest
+   distance, has to fit in a non-negative I64 */
+template <Int dim>
+struct KeyBits {
+  enum { value = 62 / dim };
+};
+
+/* like dists_from_coords_dim(), but the curve covers a given
+   (typically global) bounding box and each point gets a single
+   key made of all the bits of its Hilbert distance */
+template <Int dim>
+static Read<I64> keys_from_coords_dim(Reals coords, BBox<dim> bbox) {
+  Real maxl = 0;
+  for (Int i = 0; i < dim; ++i) maxl = max2(maxl, bbox.max[i] - bbox.min[i]);
+  if (maxl == 0.0) maxl = 1.0;
+  LO npts = coords.size() / dim;
+  Write<I64> out(npts);
+  auto f = LAMBDA(LO i) {
+    hilbert::coord_t X[dim];
+    Int nbits = KeyBits<dim>::value;
+    for (Int j = 0; j < dim; ++j) {
+      X[j] = to_grid(coords[i * dim + j], bbox.min[j], maxl, nbits);
+    }
+    hilbert::AxestoTranspose(X, nbits, dim);
+    hilbert::coord_t Y[dim];
+    hilbert::untranspose(X, Y, nbits, dim);
+    hilbert::coord_t key = 0;
+    for (Int j = 0; j < dim; ++j) key = (key << nbits) | Y[j];
+    out[i] = static_cast<I64>(key);
+  };
+  parallel_for(npts, f);
+  return out;
+}
+
+/* find (nparts - 1) keys that cut the globally sorted sequence
+   of keys into pieces of nearly equal weight.
+   each splitter keeps an interval of keys known to contain it,
+   and splitters whose intervals coincide share them.
+   every round, the intervals that still hold too much weight
+   split one histogram of (nbins) boundaries between them, and
+   the global weight below each boundary is found with one
+   allreduce of that fixed size, however many parts there are. */
+static std::vector<I64> find_splitters(CommPtr comm, Read<I64> keys,
+    Read<I64> weights, I64 key_end, I32 nparts, Real tolerance) {
+  enum { nbins = 1024 };
+  auto perm = sort_by_keys(keys);
+  auto h_keys = HostRead<I64>(unmap(perm, keys, 1));
+  auto h_weights = HostRead<I64>(unmap(perm, weights, 1));
+  auto n = h_keys.size();
+  std::vector<I64> prefix(std::size_t(n + 1), 0);
+  for (LO i = 0; i < n; ++i) prefix[i + 1] = prefix[i] + h_weights[i];
+  auto local_below = [&](I64 bound) {
+    auto it = std::lower_bound(h_keys.data(), h_keys.data() + n, bound);
+    return prefix[std::size_t(it - h_keys.data())];
+  };
+  auto total = comm->allreduce(prefix.back(), OMEGA_H_SUM);
+  auto tol_weight = I64(tolerance * Real(total) / Real(nparts));
+  auto nsplitters = std::size_t(nparts - 1);
+  std::vector<I64> targets(nsplitters);
+  std::vector<I64> lo(nsplitters, 0);
+  std::vector<I64> hi(nsplitters, key_end);
+  std::vector<I64> lo_weight(nsplitters, 0);
+  std::vector<I64> hi_weight(nsplitters, total);
+  for (std::size_t i = 0; i < nsplitters; ++i) {
+    auto part = I64(i + 1);
+    targets[i] = (total / nparts) * part + ((total % nparts) * part) / nparts;
+  }
+  auto is_open = [&](std::size_t i) {
+    return (hi[i] - lo[i] > 1) && (hi_weight[i] - lo_weight[i] > tol_weight);
+  };
+  while (true) {
+    /* targets are sorted, so splitters sharing an interval are adjacent */
+    std::vector<std::size_t> group_starts;
+    for (std::size_t i = 0; i < nsplitters; ++i) {
+      if (!is_open(i)) continue;
+      if (group_starts.empty() || lo[group_starts.back()] != lo[i]) {
+        group_starts.push_back(i);
+      }
+    }
+    if (group_starts.empty()) break;
+    auto ngroups = group_starts.size();
+    auto per_group = max2(I64(nbins) / I64(ngroups), I64(1));
+    ngroups = std::min(ngroups, std::size_t(nbins));
+    std::vector<I64> bounds;
+    std::vector<std::size_t> group_ends;
+    for (std::size_t g = 0; g < ngroups; ++g) {
+      auto i = group_starts[g];
+      auto step = max2((hi[i] - lo[i]) / (per_group + 1), I64(1));
+      auto b = lo[i] + step;
+      for (I64 j = 0; j < per_group && b < hi[i]; ++j, b += step) {
+        bounds.push_back(b);
+      }
+      group_ends.push_back(bounds.size());
+    }
+    std::vector<I64> below(bounds.size());
+    for (std::size_t k = 0; k < bounds.size(); ++k) {
+      below[k] = local_below(bounds[k]);
+    }
+    below = comm->allreduce(
+        below, std::vector<Omega_h_Op>(below.size(), OMEGA_H_SUM));
+    for (std::size_t g = 0; g < ngroups; ++g) {
+      auto first = g ? group_ends[g - 1] : 0;
+      auto old_lo = lo[group_starts[g]];
+      for (auto i = group_starts[g]; i < nsplitters && lo[i] == old_lo; ++i) {
+        if (!is_open(i)) continue;
+        auto new_lo = lo[i];
+        auto new_hi = hi[i];
+        for (auto k = first; k < group_ends[g]; ++k) {
+          auto w = below[k];
+          if (w < targets[i]) {
+            new_lo = bounds[k];
+            lo_weight[i] = w;
+          } else if (new_hi == hi[i]) {
+            new_hi = bounds[k];
+            hi_weight[i] = w;
+          }
+        }
+        lo[i] = new_lo;
+        hi[i] = new_hi;
+      }
+    }
+  }
+  std::vector<I64> splitters(nsplitters);
+  for (std::size_t i = 0; i < nsplitters; ++i) {
+    auto lo_error = targets[i] - lo_weight[i];
+    auto hi_error = hi_weight[i] - targets[i];
+    splitters[i] = (lo_error < hi_error) ? lo[i] : hi[i];
+  }
+  std::sort(splitters.begin(), splitters.end());
+  return splitters;
+}
+
+static Read<I32> parts_from_splitters(Read<I64> keys, Read<I64> splitters) {
+  auto nsplitters = splitters.size();
+  Write<I32> out(keys.size());
+  auto f = LAMBDA(LO i) {
+    /* the number of splitters (<=) this key */
+    LO l = 0;
+    LO r = nsplitters;
+    while (l < r) {
+      auto m = (l + r) / 2;
+      if (splitters[m] <= keys[i]) {
+        l = m + 1;
+      } else {
+        r = m;
+      }
+    }
+    out[i] = l;
+  };
+  parallel_for(keys.size(), f);
+  return out;
+}
+
+template <Int dim>
+static Read<I32> assign_parts_dim(CommPtr comm, Reals coords, Reals masses,
+    I32 nparts, Real tolerance) {
+  auto bbox = find_bounding_box<dim>(coords);
+  std::vector<Real> extrema;
+  std::vector<Omega_h_Op> ops;
+  for (Int i = 0; i < dim; ++i) {
+    extrema.push_back(bbox.min[i]);
+    ops.push_back(OMEGA_H_MIN);
+    extrema.push_back(bbox.max[i]);
+    ops.push_back(OMEGA_H_MAX);
+  }
+  extrema.push_back(max(masses));
+  ops.push_back(OMEGA_H_MAX);
+  extrema = comm->allreduce(extrema, ops);
+  for (Int i = 0; i < dim; ++i) {
+    bbox.min[i] = extrema[std::size_t(i * 2 + 0)];
+    bbox.max[i] = extrema[std::size_t(i * 2 + 1)];
+  }
+  auto keys = keys_from_coords_dim<dim>(coords, bbox);
+  auto weights = quantize_masses(masses, extrema.back());
+  auto key_end = I64(1) << (KeyBits<dim>::value * dim);
+  auto splitters =
+      find_splitters(comm, keys, weights, key_end, nparts, tolerance);
+  HostWrite<I64> h_splitters(LO(splitters.size()));
+  for (LO i = 0; i < h_splitters.size(); ++i) {
+    h_splitters[i] = splitters[std::size_t(i)];
+  }
+  return parts_from_splitters(keys, h_splitters.write());
+}
+
+Read<I32> assign_parts(CommPtr comm, Reals coords, Int dim, Reals masses,
+    I32 nparts, Real tolerance) {
+  if (dim == 3) {
+    return assign_parts_dim<3>(comm, coords, masses, nparts, tolerance);
+  }
+  if (dim == 2) {
+    return assign_parts_dim<2>(comm, coords, masses, nparts, tolerance);
+  }
+  NORETURN(Read<I32>());
+}
+
+Remotes partition(CommPtr comm, Reals coords, Int dim, Reals masses,
+    Remotes owners, Real tolerance) {
+  if (comm->size() == 1) return owners;
+  auto parts =
+      assign_parts(comm, coords, dim, masses, comm->size(), tolerance);
+  Dist dist;
+  dist.set_parent_comm(comm);
+  dist.set_dest_ranks(parts);
+  return dist.exch(owners, 1);
+}
+
 }  // end namespace hilbert
 
 }  // end namespace Omega_h
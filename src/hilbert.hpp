@@ -104,6 +104,21 @@ INLINE void untranspose(coord_t const in[], coord_t out[], int b, int n) {
    the bounding box of the points */
 LOs sort_coords(Reals coords, Int dim);
 
+/* assign each point to one of (nparts) parts by cutting a global
+   Hilbert curve into pieces of nearly equal total mass.
+   parts are numbered in curve order, so parts with nearby
+   numbers are nearby in space */
+Read<I32> assign_parts(CommPtr comm, Reals coords, Int dim, Reals masses,
+    I32 nparts, Real tolerance);
+
+/* partition points among the ranks of (comm) by cutting a global
+   Hilbert curve into pieces of nearly equal total mass.
+   (tolerance) is the allowed imbalance relative to the average
+   mass per rank. returns, for each point a rank receives, its
+   entry in (owners) */
+Remotes partition(CommPtr comm, Reals coords, Int dim, Reals masses,
+    Remotes owners, Real tolerance);
+
 }  // end namespace hilbert
 
 }  // end namespace Omega_h
@@ -9,8 +9,17 @@ namespace indset {
 
 enum { NOT_IN, IN, UNKNOWN };
 
-static Read<I8> local_iteration(
-    LOs xadj, LOs adj, Reals quality, Read<GO> global, Read<I8> old_state) {
+enum { ROUNDS_PER_CHECK = 4 };
+
+static Read<I64> hash_globals(Read<GO> global) {
+  Write<I64> hashes(global.size());
+  auto f = LAMBDA(LO i) { hashes[i] = hash_global(global[i]); };
+  parallel_for(global.size(), f);
+  return hashes;
+}
+
+static Read<I8> local_iteration(LOs xadj, LOs adj, Reals quality,
+    Read<GO> global, Read<I64> hashes, Read<I8> old_state) {
   auto n = global.size();
   Write<I8> new_state = deep_copy(old_state);
   auto f = LAMBDA(LO v) {
@@ -34,8 +43,10 @@ static Read<I8> local_iteration(
       auto u_qual = quality[u];
       // neighbor has higher quality
       if (u_qual > v_qual) return;
-      // neighbor has equal quality, tiebreaker by global ID
-      if (u_qual == v_qual && global[u] > global[v]) return;
+      if (u_qual < v_qual) continue;
+      // neighbor has equal quality, tiebreaker by hashed global ID
+      if (hashes[u] > hashes[v]) return;
+      if (hashes[u] == hashes[v] && global[u] > global[v]) return;
     }
     // only local maxima reach this line
     new_state[v] = IN;
@@ -45,14 +56,15 @@ static Read<I8> local_iteration(
 }
 
 static Read<I8> iteration(Mesh* mesh, Int dim, LOs xadj, LOs adj, Reals quality,
-    Read<GO> global, Read<I8> old_state) {
-  auto local_state = local_iteration(xadj, adj, quality, global, old_state);
+    Read<GO> global, Read<I64> hashes, Read<I8> old_state) {
+  auto local_state =
+      local_iteration(xadj, adj, quality, global, hashes, old_state);
   auto synced_state = mesh->sync_array(dim, local_state, 1);
   return synced_state;
 }
 
 static Read<I8> find(Mesh* mesh, Int dim, LOs xadj, LOs adj, Reals quality,
-    Read<GO> global, Read<I8> candidates) {
+    Read<GO> global, Read<I8> candidates, Int* p_nrounds) {
   auto n = global.size();
   CHECK(quality.size() == n);
   CHECK(candidates.size() == n);
@@ -64,23 +76,34 @@ static Read<I8> find(Mesh* mesh, Int dim, LOs xadj, LOs adj, Reals quality,
       initial_state[i] = NOT_IN;
   };
   parallel_for(n, f);
+  CommPhase phase("indset");
   auto comm = mesh->comm();
+  auto hashes = hash_globals(global);
   auto state = Read<I8>(initial_state);
+  Int nrounds = 0;
+  /* every round decides at least the best undecided candidate, so
+     this terminates. rounds after convergence change nothing, so the
+     global check only happens every few rounds */
   while (comm->allreduce(max(state), OMEGA_H_MAX) == UNKNOWN) {
-    state = iteration(mesh, dim, xadj, adj, quality, global, state);
+    for (Int i = 0; i < ROUNDS_PER_CHECK; ++i) {
+      state = iteration(mesh, dim, xadj, adj, quality, global, hashes, state);
+    }
+    nrounds += ROUNDS_PER_CHECK;
   }
+  if (p_nrounds) *p_nrounds = nrounds;
   return state;
 }
 }
 
-Read<I8> find_indset(
-    Mesh* mesh, Int ent_dim, Reals quality, Read<I8> candidates) {
+Read<I8> find_indset(Mesh* mesh, Int ent_dim, Reals quality,
+    Read<I8> candidates, Int* p_nrounds) {
   mesh->owners_have_all_upward(ent_dim);
   auto graph = mesh->ask_star(ent_dim);
   auto xadj = graph.a2ab;
   auto adj = graph.ab2b;
   auto globals = mesh->ask_globals(ent_dim);
-  return indset::find(mesh, ent_dim, xadj, adj, quality, globals, candidates);
+  return indset::find(
+      mesh, ent_dim, xadj, adj, quality, globals, candidates, p_nrounds);
 }
 
 }  // end namespace Omega_h
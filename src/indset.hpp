@@ -1,12 +1,37 @@
 #ifndef INDSET_HPP
 #define INDSET_HPP
 
+#include <cstdint>
+
 #include "internal.hpp"
 
 namespace Omega_h {
 
-Read<I8> find_indset(
-    Mesh* mesh, Int ent_dim, Reals quality, Read<I8> candidates);
+/* a fixed mix of the bits of a global ID (the splitmix64 finalizer),
+   so that ties are broken in an order unrelated to the numbering */
+INLINE I64 hash_global(GO global) {
+  auto x = static_cast<std::uint64_t>(global);
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  x = x ^ (x >> 31);
+  return static_cast<I64>(x >> 1);
+}
+
+/* chooses candidates of locally maximal quality, breaking ties by
+   hashed global IDs so that chains of equal quality resolve in few
+   rounds regardless of how they are numbered.
+   the result depends only on qualities and global IDs, and is a
+   maximal independent set of the candidates.
+   rounds repeat until every candidate is decided. each round
+   decides at least the best undecided candidate and its neighbors,
+   so the rounds are bounded by the longest chain of neighbors of
+   strictly decreasing priority, at worst the number of candidates.
+   along a chain of equal qualities the hashed priorities act like
+   random ones, whose longest such chain is O(log n) expected.
+   rounds run in groups of four between global checks.
+   if (p_nrounds) is not null, it receives the number of rounds */
+Read<I8> find_indset(Mesh* mesh, Int ent_dim, Reals quality,
+    Read<I8> candidates, Int* p_nrounds = nullptr);
 
 }  // end namespace Omega_h
 
@@ -1,9 +1,11 @@
 #include "inertia.hpp"
 
+#include <cstdlib>
 #include <iostream>
 
 #include "access.hpp"
 #include "array.hpp"
+#include "atomics.hpp"
 #include "bipart.hpp"
 #include "eigen.hpp"
 #include "loop.hpp"
@@ -71,14 +73,6 @@ Reals get_distances(Reals coords, Vector<3> center, Vector<3> axis) {
   return distances;
 }
 
-Real get_half_weight(CommPtr comm, Reals masses, Read<I8> marked) {
-  auto n = masses.size();
-  Write<Real> weighted(n);
-  auto f = LAMBDA(LO i) { weighted[i] = (Real(marked[i]) * masses[i]); };
-  parallel_for(n, f);
-  return repro_sum(comm, Reals(weighted));
-}
-
 Read<I8> mark_half(Reals distances, Real distance) {
   auto n = distances.size();
   Write<I8> marked(n);
@@ -87,36 +81,90 @@ Read<I8> mark_half(Reals distances, Real distance) {
   return marked;
 }
 
-bool mark_axis_bisection(CommPtr comm, Reals distances, Reals masses,
-    Real total_mass, Real tolerance, Read<I8>& marked) {
+INLINE Real bin_edge(Real lo, Real hi, Int b, Int nbins) {
+  return lo + (hi - lo) * Real(b) / nbins;
+}
+
+/* the mass of the items in each of (nbins) equal bins of (lo, hi],
+   summed on the device and returned on the host */
+static std::vector<I64> bin_masses(Reals distances, Read<I64> weights,
+    Real lo, Real hi, Int nbins) {
   auto n = distances.size();
-  CHECK(n == masses.size());
-  auto max_dist = comm->allreduce(max(distances), OMEGA_H_MAX);
-  auto min_dist = comm->allreduce(min(distances), OMEGA_H_MIN);
-  auto range = max2(fabs(min_dist), fabs(max_dist));
-  auto step = range / 2.;
-  Real distance = 0.;
-  for (Int i = 0; i < MANTISSA_BITS; ++i) {
-    marked = mark_half(distances, distance);
-    auto half_weight = get_half_weight(comm, masses, marked);
-    if (are_close(half_weight, total_mass / 2., tolerance, 0.)) {
-      return true;
+  Write<I64> bins(nbins, 0);
+  auto f = LAMBDA(LO i) {
+    auto d = distances[i];
+    if (!(lo < d && d <= hi)) return;
+    auto b = min2(max2(Int((d - lo) / (hi - lo) * nbins), 0), nbins - 1);
+    while (b > 0 && d <= bin_edge(lo, hi, b, nbins)) --b;
+    while (b < nbins - 1 && d > bin_edge(lo, hi, b + 1, nbins)) ++b;
+    atomic_add(&bins[b], weights[i]);
+  };
+  parallel_for(n, f);
+  auto h_bins = HostRead<I64>(Read<I64>(bins));
+  std::vector<I64> out(static_cast<std::size_t>(nbins));
+  for (Int b = 0; b < nbins; ++b) out[std::size_t(b)] = h_bins[b];
+  return out;
+}
+
+/* finds a distance such that the items beyond it hold (fraction)
+   of the mass. each round splits the interval known to contain
+   it into many bins, sums the mass in each bin over all ranks
+   with a single allreduce, and narrows down to one bin */
+bool mark_axis_bisection(CommPtr comm, Reals distances, Reals masses,
+    Real fraction, Real tolerance, Read<I8>& marked) {
+  enum { nbins = 64 };
+  CHECK(distances.size() == masses.size());
+  auto extrema = comm->allreduce(
+      std::vector<Real>({max(distances), -min(distances), max(masses)}),
+      std::vector<Omega_h_Op>(3, OMEGA_H_MAX));
+  auto weights = quantize_masses(masses, extrema[2]);
+  auto total = comm->allreduce(I64(sum(weights)), OMEGA_H_SUM);
+  auto target = Real(total) * fraction;
+  /* the mass beyond (hi) is known, the one beyond (lo) is at least
+     the target, and the answer lies in between */
+  auto hi = extrema[0];
+  auto lo = -extrema[1];
+  lo -= max2(fabs(lo), 1.0) * EPSILON;
+  I64 hi_weight = 0;
+  auto best = hi;
+  I64 best_weight = 0;
+  auto edge = [&](Int b) { return bin_edge(lo, hi, b, nbins); };
+  for (Int round = 0; round * 6 < MANTISSA_BITS; ++round) {
+    auto hist = bin_masses(distances, weights, lo, hi, nbins);
+    hist = comm->allreduce(hist, std::vector<Omega_h_Op>(nbins, OMEGA_H_SUM));
+    auto beyond = hi_weight;
+    Int b = nbins;
+    while (true) {
+      if (fabs(Real(beyond) - target) < fabs(Real(best_weight) - target)) {
+        best = edge(b);
+        best_weight = beyond;
+      }
+      if (b == 0 || Real(beyond) >= target) break;
+      beyond += hist[std::size_t(--b)];
     }
-    if (half_weight > total_mass / 2.) {
-      distance += step;
-    } else {
-      distance -= step;
+    if (are_close(Real(best_weight), target, tolerance, 0.)) {
+      marked = mark_half(distances, best);
+      return true;
     }
-    step /= 2.;
+    if (b == 0) break;
+    /* (beyond) now includes bin (b), which holds the answer */
+    auto new_lo = edge(b);
+    auto new_hi = edge(b + 1);
+    if (!(lo < new_lo || new_hi < hi)) break;
+    hi_weight = beyond - hist[std::size_t(b)];
+    lo = new_lo;
+    hi = new_hi;
   }
+  marked = mark_half(distances, best);
   return false;
 }
 
 Read<I8> mark_bisection_internal(CommPtr comm, Reals coords, Reals masses,
-    Real tolerance, Vector<3> axis, Vector<3> center, Real total_mass) {
+    Real tolerance, Vector<3> axis, Vector<3> center, Real fraction) {
   auto dists = get_distances(coords, center, axis);
   Read<I8> marked;
-  if (mark_axis_bisection(comm, dists, masses, total_mass, tolerance, marked)) {
+  if (mark_axis_bisection(
+          comm, dists, masses, fraction, tolerance, marked)) {
     return marked;
   }
   // if we couldn't find a decent cutting plane, this may be a highly
@@ -127,7 +175,7 @@ Read<I8> mark_bisection_internal(CommPtr comm, Reals coords, Reals masses,
     axis2[i / 2] += (i % 2) ? 1e-3 : -1e-3;
     dists = get_distances(coords, center, axis2);
     if (mark_axis_bisection(
-            comm, dists, masses, total_mass, tolerance, marked)) {
+            comm, dists, masses, fraction, tolerance, marked)) {
       return marked;
     }
   }
@@ -137,48 +185,79 @@ Read<I8> mark_bisection_internal(CommPtr comm, Reals coords, Reals masses,
 
 }  // end anonymous namespace
 
-Read<I8> mark_bisection(
-    CommPtr comm, Reals coords, Reals masses, Real tolerance, Vector<3>& axis) {
+Read<I8> mark_bisection(CommPtr comm, Reals coords, Reals masses,
+    Real tolerance, Vector<3>& axis, Real fraction) {
   CHECK(coords.size() == masses.size() * 3);
   auto total_mass = repro_sum(comm, masses);
   auto center = get_center(comm, coords, masses, total_mass);
   axis = get_axis(comm, coords, masses, center);
   return mark_bisection_internal(
-      comm, coords, masses, tolerance, axis, center, total_mass);
+      comm, coords, masses, tolerance, axis, center, fraction);
 }
 
-Read<I8> mark_bisection_given_axis(
-    CommPtr comm, Reals coords, Reals masses, Real tolerance, Vector<3> axis) {
+Read<I8> mark_bisection_given_axis(CommPtr comm, Reals coords, Reals masses,
+    Real tolerance, Vector<3> axis, Real fraction) {
   CHECK(coords.size() == masses.size() * 3);
   auto total_mass = repro_sum(comm, masses);
   auto center = get_center(comm, coords, masses, total_mass);
   return mark_bisection_internal(
-      comm, coords, masses, tolerance, axis, center, total_mass);
+      comm, coords, masses, tolerance, axis, center, fraction);
 }
 
 Rib recursively_bisect(CommPtr comm, Reals& coords, Reals& masses,
     Remotes& owners, Real tolerance, Rib hints) {
+  return recursively_bisect(
+      comm, coords, masses, owners, tolerance, hints, std::vector<I32>());
+}
+
+Rib recursively_bisect(CommPtr comm, Reals& coords, Reals& masses,
+    Remotes& owners, Real tolerance, Rib hints,
+    std::vector<I32> const& node_sizes) {
   if (comm->size() == 1) {
     return Rib();
   }
-  CHECK(comm->size() % 2 == 0);
+  auto nlow = comm->size() / 2;
+  /* cut between the nodes, as close to the middle as possible */
+  std::size_t nlow_nodes = 0;
+  I32 before = 0;
+  for (std::size_t i = 0; i + 1 < node_sizes.size(); ++i) {
+    before += node_sizes[i];
+    auto half = comm->size() / 2;
+    if (!nlow_nodes || std::abs(before - half) < std::abs(nlow - half)) {
+      nlow = before;
+      nlow_nodes = i + 1;
+    }
+  }
+  /* the marked items go to the upper ranks */
+  auto fraction = Real(comm->size() - nlow) / Real(comm->size());
   Vector<3> axis;
   Read<I8> marks;
   if (hints.axes.empty()) {
-    marks = inertia::mark_bisection(comm, coords, masses, tolerance, axis);
+    marks = inertia::mark_bisection(
+        comm, coords, masses, tolerance, axis, fraction);
   } else {
     axis = hints.axes.front();
     hints.axes.erase(hints.axes.begin());
     marks = inertia::mark_bisection_given_axis(
-        comm, coords, masses, tolerance, axis);
+        comm, coords, masses, tolerance, axis, fraction);
   }
-  auto dist = bi_partition(comm, marks);
+  auto dist = bi_partition(comm, marks, nlow);
   coords = dist.exch(coords, 3);
   masses = dist.exch(masses, 1);
   owners = dist.exch(owners, 1);
-  auto halfsize = comm->size() / 2;
-  comm = comm->split(comm->rank() / halfsize, comm->rank() % halfsize);
-  auto out = recursively_bisect(comm, coords, masses, owners, tolerance, hints);
+  auto is_upper = (comm->rank() >= nlow);
+  comm = comm->split(I32(is_upper), comm->rank() - (is_upper ? nlow : 0));
+  std::vector<I32> sub_node_sizes;
+  if (nlow_nodes) {
+    auto mid = node_sizes.begin() + std::ptrdiff_t(nlow_nodes);
+    if (is_upper) {
+      sub_node_sizes.assign(mid, node_sizes.end());
+    } else {
+      sub_node_sizes.assign(node_sizes.begin(), mid);
+    }
+  }
+  auto out = recursively_bisect(
+      comm, coords, masses, owners, tolerance, hints, sub_node_sizes);
   out.axes.insert(out.axes.begin(), axis);
   return out;
 }
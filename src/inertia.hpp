@@ -11,12 +11,23 @@ struct Rib {
   std::vector<Vector<3>> axes;
 };
 
-Read<I8> mark_bisection(
-    CommPtr comm, Reals coords, Reals masses, Real tolerance, Vector<3>& axis);
-Read<I8> mark_bisection_given_axis(
-    CommPtr comm, Reals coords, Reals masses, Real tolerance, Vector<3> axis);
+/* the marked items hold (fraction) of the total mass */
+Read<I8> mark_bisection(CommPtr comm, Reals coords, Reals masses,
+    Real tolerance, Vector<3>& axis, Real fraction = 0.5);
+Read<I8> mark_bisection_given_axis(CommPtr comm, Reals coords, Reals masses,
+    Real tolerance, Vector<3> axis, Real fraction = 0.5);
+/* any number of ranks may be used: each communicator is split
+   into halves of (size / 2) and (size - size / 2) ranks,
+   and the mass is split in the same proportions */
 Rib recursively_bisect(CommPtr comm, Reals& coords, Reals& masses,
     Remotes& owners, Real tolerance, Rib hints);
+/* (node_sizes) is the number of ranks on each node, whose ranks
+   must be contiguous in (comm) (see Comm::group_by_node).
+   the first cuts separate nodes, so that later cuts, and the
+   part boundaries they make, fall within nodes */
+Rib recursively_bisect(CommPtr comm, Reals& coords, Reals& masses,
+    Remotes& owners, Real tolerance, Rib hints,
+    std::vector<I32> const& node_sizes);
 }
 
 }  // end namespace Omega_h
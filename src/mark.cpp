@@ -94,6 +94,24 @@ Read<I8> mark_dual_layers(Mesh* mesh, Read<I8> marks, Int nlayers) {
   return marks;
 }
 
+Read<I8> mark_vert_layers(Mesh* mesh, Read<I8> elem_marks, Int nlayers) {
+  for (Int i = 0; i < nlayers; ++i) {
+    auto vert_marks = mark_down(mesh, mesh->dim(), VERT, elem_marks);
+    elem_marks = mark_up(mesh, VERT, mesh->dim(), vert_marks);
+  }
+  return elem_marks;
+}
+
+Read<I8> restrict_to_region(
+    Mesh* mesh, Int ent_dim, Read<I8> marks, Read<I8> elems_are_in) {
+  if (!elems_are_in.exists()) return marks;
+  CHECK(elems_are_in.size() == mesh->nelems());
+  if (ent_dim < mesh->dim()) {
+    elems_are_in = mark_down(mesh, mesh->dim(), ent_dim, elems_are_in);
+  }
+  return land_each(marks, elems_are_in);
+}
+
 GO count_owned_marks(Mesh* mesh, Int ent_dim, Read<I8> marks) {
   if (mesh->could_be_shared(ent_dim)) {
     marks = land_each(marks, mesh->owned(ent_dim));
@@ -101,11 +119,15 @@ GO count_owned_marks(Mesh* mesh, Int ent_dim, Read<I8> marks) {
   return mesh->comm()->allreduce(GO(sum(marks)), OMEGA_H_SUM);
 }
 
-Read<I8> mark_sliver_layers(Mesh* mesh, Real qual_ceil, Int nlayers) {
+Read<I8> mark_sliver_layers(
+    Mesh* mesh, Real qual_ceil, Int nlayers, Read<I8> elems_are_in) {
   CHECK(mesh->parting() == OMEGA_H_GHOSTED);
   auto quals = mesh->ask_qualities();
   auto elems_are_slivers = each_lt(quals, qual_ceil);
-  return mark_dual_layers(mesh, elems_are_slivers, nlayers);
+  elems_are_slivers =
+      restrict_to_region(mesh, mesh->dim(), elems_are_slivers, elems_are_in);
+  auto marks = mark_dual_layers(mesh, elems_are_slivers, nlayers);
+  return restrict_to_region(mesh, mesh->dim(), marks, elems_are_in);
 }
 
 }  // end namespace Omega_h
@@ -18,9 +18,19 @@ Read<I8> mark_by_owner(Mesh* mesh, Int ent_dim, I32 rank);
 
 Read<I8> mark_dual_layers(Mesh* mesh, Read<I8> marks, Int nlayers);
 
+/* adds (nlayers) layers of elements sharing a vertex with the
+   marked elements. unlike mark_dual_layers(), any parting will do */
+Read<I8> mark_vert_layers(Mesh* mesh, Read<I8> elem_marks, Int nlayers);
+
+/* unmarks the entities outside the closure of the elements
+   marked by (elems_are_in), unless that array does not exist */
+Read<I8> restrict_to_region(
+    Mesh* mesh, Int ent_dim, Read<I8> marks, Read<I8> elems_are_in);
+
 GO count_owned_marks(Mesh* mesh, Int ent_dim, Read<I8> marks);
 
-Read<I8> mark_sliver_layers(Mesh* mesh, Real qual_ceil, Int nlayers);
+Read<I8> mark_sliver_layers(Mesh* mesh, Real qual_ceil, Int nlayers,
+    Read<I8> elems_are_in = Read<I8>());
 
 }  // end namespace Omega_h
 
@@ -2,19 +2,26 @@
 
 #include <algorithm>
 
+#include "adapt_stats.hpp"
 #include "adjacency.hpp"
 #include "array.hpp"
 #include "bcast.hpp"
+#include "coloring.hpp"
 #include "ghost.hpp"
 #include "graph.hpp"
+#include "hilbert.hpp"
 #include "inertia.hpp"
+#include "loop.hpp"
 #include "map.hpp"
 #include "mark.hpp"
 #include "migrate.hpp"
+#include "multilevel.hpp"
 #include "quality.hpp"
 #include "reorder.hpp"
+#include "scan.hpp"
 #include "simplices.hpp"
 #include "size.hpp"
+#include "sort.hpp"
 #include "tag.hpp"
 
 namespace Omega_h {
@@ -22,6 +29,10 @@ namespace Omega_h {
 Mesh::Mesh() : dim_(-1), parting_(-1) {
   for (Int i = 0; i <= 3; ++i) nents_[i] = -1;
   parting_ = OMEGA_H_ELEM_BASED;
+  partitioner_ = OMEGA_H_RIB;
+  parts_per_rank_ = 1;
+  nghost_layers_ = 0;
+  ghosts_are_partial_ = false;
   keeps_canonical_globals_ = true;
 }
 
@@ -186,6 +197,7 @@ void Mesh::remove_tag(Int dim, std::string const& name) {
   check_dim2(dim);
   CHECK(has_tag(dim, name));
   tags_[dim].erase(tag_iter(dim, name));
+  if (dim == VERT) tag_functions_.erase(name);
 }
 
 bool Mesh::has_tag(Int dim, std::string const& name) const {
@@ -245,6 +257,15 @@ Graph Mesh::ask_star(Int dim) {
 
 Graph Mesh::ask_dual() { return ask_adj(dim(), dim()); }
 
+Graph Mesh::ask_colors(Int dim) {
+  check_dim2(dim);
+  if (!colors_[dim]) {
+    auto colors = color_by_shared(ask_graph(dim, VERT), ask_graph(VERT, dim));
+    colors_[dim] = std::make_shared<Graph>(group_by_color(colors));
+  }
+  return *(colors_[dim]);
+}
+
 struct HasName {
   std::string const& name_;
   HasName(std::string const& name) : name_(name) {}
@@ -294,6 +315,20 @@ void Mesh::add_adj(Int from, Int to, Adj adj) {
   adjs_[from][to] = std::make_shared<Adj>(adj);
 }
 
+void Mesh::remove_adj(Int from, Int to) {
+  check_dim(from);
+  check_dim(to);
+  CHECK(from != to + 1);
+  adjs_[from][to] = AdjPtr();
+}
+
+void Mesh::remove_neighbor_caches() {
+  for (Int dim = 0; dim <= this->dim(); ++dim) {
+    adjs_[dim][dim] = AdjPtr();
+    colors_[dim] = std::shared_ptr<Graph>();
+  }
+}
+
 Adj Mesh::derive_adj(Int from, Int to) {
   check_dim(from);
   check_dim2(to);
@@ -427,48 +462,246 @@ Omega_h_Parting Mesh::parting() const {
 }
 
 void Mesh::set_parting(Omega_h_Parting parting, bool verbose) {
+  auto nlayers = 1;
+  if (parting_ == OMEGA_H_GHOSTED && !ghosts_are_partial_) {
+    nlayers = nghost_layers_;
+  }
+  set_parting(parting, nlayers, verbose);
+}
+
+void Mesh::set_parting(Omega_h_Parting parting, Int nlayers, bool verbose) {
+  CHECK(parting != OMEGA_H_GHOSTED || nlayers >= 1);
+  if (parting != OMEGA_H_GHOSTED) nlayers = 0;
   if ((parting_ == -1) || (comm_->size() == 1)) {
     parting_ = parting;
+    nghost_layers_ = nlayers;
     return;
   }
-  if (parting_ == parting) {
+  if (parting_ == parting && nghost_layers_ == nlayers &&
+      !ghosts_are_partial_) {
     return;
   }
+  CommPhase phase("ghosting");
+  AdaptTimer timer(ADAPT_GHOSTING);
   if (parting_ != OMEGA_H_ELEM_BASED) {
     partition_by_elems(this, verbose);
     parting_ = OMEGA_H_ELEM_BASED;
+    nghost_layers_ = 0;
+    ghosts_are_partial_ = false;
   }
   if (parting == OMEGA_H_GHOSTED) {
-    ghost_mesh(this, verbose);
+    ghost_mesh(this, nlayers, verbose);
   } else if (parting == OMEGA_H_VERT_BASED) {
     partition_by_verts(this, verbose);
   }
   parting_ = parting;
+  nghost_layers_ = nlayers;
+}
+
+Int Mesh::nghost_layers() const { return nghost_layers_; }
+
+void Mesh::ghost_partially(Read<I8> verts_are_centers, bool verbose) {
+  if ((parting_ == -1) || (comm_->size() == 1)) {
+    parting_ = OMEGA_H_GHOSTED;
+    nghost_layers_ = 1;
+    return;
+  }
+  /* the marks only describe this partitioning, so any other
+     starting point falls back to full ghosting */
+  if (parting_ != OMEGA_H_ELEM_BASED) {
+    set_parting(OMEGA_H_GHOSTED, verbose);
+    return;
+  }
+  CommPhase phase("ghosting");
+  AdaptTimer timer(ADAPT_GHOSTING);
+  ghost_mesh(this, verts_are_centers, verbose);
+  parting_ = OMEGA_H_GHOSTED;
+  nghost_layers_ = 1;
+  ghosts_are_partial_ = true;
 }
 
 void Mesh::migrate(Remotes new_elems2old_owners, bool verbose) {
-  migrate_mesh(this, new_elems2old_owners, verbose);
+  migrate_mesh_delta(this, new_elems2old_owners, verbose);
 }
 
 void Mesh::reorder() { reorder_by_hilbert(this); }
 
-void Mesh::balance() {
-  if (comm_->size() == 1) return;
+/* the work of adapting an element is roughly proportional
+   to the number of elements it will become, which is what
+   the size field (or metric) predicts */
+static Reals predict_elem_work(Mesh* mesh) {
+  if (mesh->has_tag(VERT, "metric")) {
+    return expected_elems_per_elem_metric(
+        mesh, mesh->get_array<Real>(VERT, "metric"));
+  }
+  if (mesh->has_tag(VERT, "size")) {
+    return expected_elems_per_elem_iso(
+        mesh, mesh->get_array<Real>(VERT, "size"));
+  }
+  return Reals(mesh->nelems(), 1);
+}
+
+/* with over-decomposition, each element carries the global
+   part it belongs to in the "omega_h_part" tag, which elements
+   inherit through adaptation but which is not written to files.
+   balancing assigns whole parts to ranks, consecutive parts to
+   the same rank, so it only needs the weight of each part.
+   the weights are summed per part on the device and reduced onto
+   rank (p / parts_per_rank), so each rank only scans its own parts.
+   parts are recomputed when there are none yet, when their number
+   changed, or when one grew too heavy.
+   returns the new rank of each element */
+static Read<I32> ranks_of_parts(
+    Mesh* mesh, Reals ecoords, Reals masses, Real tolerance) {
+  auto comm = mesh->comm();
+  auto dim = mesh->dim();
+  auto ppr = mesh->parts_per_rank();
+  auto nparts = comm->size() * ppr;
+  auto is_fresh =
+      !mesh->has_tag(dim, "omega_h_part") ||
+      max(comm, mesh->get_array<I32>(dim, "omega_h_part")) + 1 != nparts;
+  while (true) {
+    if (is_fresh) {
+      auto parts = hilbert::assign_parts(
+          comm, ecoords, dim, masses, nparts, tolerance * ppr);
+      if (mesh->has_tag(dim, "omega_h_part")) {
+        mesh->remove_tag(dim, "omega_h_part");
+      }
+      mesh->add_tag(dim, "omega_h_part", 1, OMEGA_H_INHERIT,
+          OMEGA_H_DONT_OUTPUT, parts);
+    }
+    auto parts = mesh->get_array<I32>(dim, "omega_h_part");
+    /* sum the masses of the local elements of each part present */
+    auto nelems = parts.size();
+    auto perm = sort_by_keys(parts);
+    auto sorted_parts = unmap(perm, parts, 1);
+    Write<I8> starts_run(nelems);
+    auto mark_runs = LAMBDA(LO i) {
+      starts_run[i] = (i == 0 || sorted_parts[i] != sorted_parts[i - 1]);
+    };
+    parallel_for(nelems, mark_runs);
+    auto runs2sorted = collect_marked(Read<I8>(starts_run));
+    auto sorted2runs = offset_scan(Read<I8>(starts_run));
+    auto nruns = runs2sorted.size();
+    Write<LO> run_offsets(nruns + 1, nelems);
+    map_into(runs2sorted, LOs(nruns, 0, 1), run_offsets, 1);
+    auto run_masses = fan_reduce(
+        LOs(run_offsets), unmap(perm, masses, 1), 1, OMEGA_H_SUM);
+    auto run_parts = unmap(runs2sorted, sorted_parts, 1);
+    Write<I32> owner_ranks(nruns);
+    Write<LO> owner_idxs(nruns);
+    auto find_owners = LAMBDA(LO r) {
+      owner_ranks[r] = run_parts[r] / ppr;
+      owner_idxs[r] = run_parts[r] % ppr;
+    };
+    parallel_for(nruns, find_owners);
+    auto runs2owners = Dist(
+        comm, Remotes(Read<I32>(owner_ranks), LOs(owner_idxs)), LO(ppr));
+    auto weights = runs2owners.exch_reduce(run_masses, 1, OMEGA_H_SUM);
+    auto local_total = sum(weights);
+    auto extrema = comm->allreduce(std::vector<Real>({local_total,
+                                       max(weights)}),
+        std::vector<Omega_h_Op>({OMEGA_H_SUM, OMEGA_H_MAX}));
+    auto total = extrema[0];
+    auto heaviest = extrema[1];
+    if (!is_fresh && heaviest > 2.0 * total / Real(nparts)) {
+      is_fresh = true;
+      continue;
+    }
+    auto avg = total / Real(comm->size());
+    auto before = comm->exscan(local_total, OMEGA_H_SUM);
+    /* only this rank's few parts are scanned on the host */
+    auto h_weights = HostRead<Real>(weights);
+    HostWrite<I32> part_ranks(ppr);
+    for (Int i = 0; i < ppr; ++i) {
+      auto middle = before + h_weights[i] / 2.0;
+      auto rank = (avg > 0.0) ? I32(middle / avg) : comm->rank();
+      part_ranks[i] = min2(rank, comm->size() - 1);
+      before += h_weights[i];
+    }
+    auto run_ranks =
+        runs2owners.invert().exch(Read<I32>(part_ranks.write()), 1);
+    Write<I32> elem_ranks(nelems);
+    auto scatter_ranks = LAMBDA(LO i) {
+      elem_ranks[perm[i]] = run_ranks[sorted2runs[i + 1] - 1];
+    };
+    parallel_for(nelems, scatter_ranks);
+    return elem_ranks;
+  }
+}
+
+void Mesh::balance(bool predictive) {
+  /* a single rank still needs its parts assigned */
+  if (comm_->size() == 1 && parts_per_rank_ == 1) return;
   set_parting(OMEGA_H_ELEM_BASED);
-  inertia::Rib hints;
-  if (rib_hints_) hints = *rib_hints_;
+  balance(predictive ? predict_elem_work(this) : Reals(nelems(), 1));
+}
+
+void Mesh::balance(Reals masses) {
+  if (comm_->size() == 1 && parts_per_rank_ == 1) return;
+  CHECK(parting_ == OMEGA_H_ELEM_BASED);
+  CHECK(masses.size() == nelems());
   auto ecoords =
       average_field(this, dim(), LOs(nelems(), 0, 1), dim(), coords());
-  if (dim() == 2) ecoords = vectors_2d_to_3d(ecoords);
-  auto masses = Reals(nelems(), 1);
   auto owners = ask_owners(dim());
-  auto total = comm_->allreduce(GO(nelems()), OMEGA_H_SUM);
-  auto avg = Real(total) / Real(comm_->size());
-  hints = recursively_bisect(comm(), ecoords, masses, owners, 2.0 / avg, hints);
-  rib_hints_ = std::make_shared<inertia::Rib>(hints);
+  /* tolerate an imbalance of about two of the heaviest elements */
+  auto total = repro_sum(comm_, masses);
+  auto heaviest = max(comm_, masses);
+  auto avg = total / Real(comm_->size());
+  auto tolerance = 2.0 * heaviest / avg;
+  if (parts_per_rank_ > 1) {
+    CommPhase phase("partitioning");
+    Dist dist;
+    dist.set_parent_comm(comm_);
+    dist.set_dest_ranks(ranks_of_parts(this, ecoords, masses, tolerance));
+    owners = dist.exch(owners, 1);
+  } else if (partitioner_ == OMEGA_H_HILBERT) {
+    CommPhase phase("partitioning");
+    owners = hilbert::partition(
+        comm_, ecoords, dim(), masses, owners, tolerance);
+  } else if (partitioner_ == OMEGA_H_MULTILEVEL) {
+    CommPhase phase("partitioning");
+    owners = multilevel::partition(this, masses, tolerance);
+  } else {
+    inertia::Rib hints;
+    if (rib_hints_) hints = *rib_hints_;
+    if (dim() == 2) ecoords = vectors_2d_to_3d(ecoords);
+    {
+      CommPhase phase("partitioning");
+      auto comm = comm_;
+      std::vector<I32> node_sizes;
+      if (partitioner_ == OMEGA_H_NODE_RIB) {
+        comm = comm_->group_by_node(&node_sizes);
+      }
+      hints = recursively_bisect(
+          comm, ecoords, masses, owners, tolerance, hints, node_sizes);
+    }
+    rib_hints_ = std::make_shared<inertia::Rib>(hints);
+  }
   migrate(owners);
 }
 
+/* ratio of the largest per-rank sum of owned element weights
+   to the average one; 1.0 means perfectly balanced */
+Real Mesh::imbalance(bool predictive) {
+  return imbalance(predictive ? predict_elem_work(this) : Reals(nelems(), 1));
+}
+
+Real Mesh::imbalance(Reals weights) {
+  CHECK(weights.size() == nelems());
+  auto elems_are_owned = owned(dim());
+  Write<Real> owned_weights(nelems());
+  auto f = LAMBDA(LO e) {
+    owned_weights[e] = elems_are_owned[e] ? weights[e] : 0.0;
+  };
+  parallel_for(nelems(), f);
+  auto local = sum(Reals(owned_weights));
+  auto global = comm_->allreduce(std::vector<Real>({local, local}),
+      std::vector<Omega_h_Op>({OMEGA_H_MAX, OMEGA_H_SUM}));
+  if (global[1] <= 0.0) return 1.0;
+  return global[0] / (global[1] / Real(comm_->size()));
+}
+
 Graph Mesh::ask_graph(Int from, Int to) {
   if (to > from) {
     return ask_up(from, to);
@@ -485,6 +718,7 @@ Graph Mesh::ask_graph(Int from, Int to) {
 template <typename T>
 Read<T> Mesh::sync_array(Int ent_dim, Read<T> a, Int width) {
   if (!could_be_shared(ent_dim)) return a;
+  CommPhase phase("sync");
   return ask_dist(ent_dim).invert().exch(a, width);
 }
 
@@ -500,6 +734,7 @@ Read<T> Mesh::sync_subset_array(
 template <typename T>
 Read<T> Mesh::reduce_array(Int ent_dim, Read<T> a, Int width, Omega_h_Op op) {
   if (!could_be_shared(ent_dim)) return a;
+  CommPhase phase("sync");
   return ask_dist(ent_dim).exch_reduce(a, width, op);
 }
 
@@ -573,7 +808,8 @@ bool Mesh::could_be_shared(Int ent_dim) const {
 }
 
 bool Mesh::owners_have_all_upward(Int ent_dim) const {
-  return ((comm_->size() == 1) || (parting_ == OMEGA_H_GHOSTED) ||
+  return ((comm_->size() == 1) ||
+          (parting_ == OMEGA_H_GHOSTED && !ghosts_are_partial_) ||
           (parting_ == OMEGA_H_VERT_BASED && ent_dim == VERT));
 }
 
@@ -583,6 +819,11 @@ Mesh Mesh::copy_meta() const {
   m.comm_ = this->comm_;
   m.parting_ = this->parting_;
   m.rib_hints_ = this->rib_hints_;
+  m.tag_functions_ = this->tag_functions_;
+  m.partitioner_ = this->partitioner_;
+  m.parts_per_rank_ = this->parts_per_rank_;
+  m.nghost_layers_ = this->nghost_layers_;
+  m.ghosts_are_partial_ = this->ghosts_are_partial_;
   m.keeps_canonical_globals_ = this->keeps_canonical_globals_;
   return m;
 }
@@ -591,6 +832,40 @@ Mesh::RibPtr Mesh::rib_hints() const { return rib_hints_; }
 
 void Mesh::set_rib_hints(RibPtr hints) { rib_hints_ = hints; }
 
+Omega_h_Partitioner Mesh::partitioner() const { return partitioner_; }
+
+void Mesh::set_partitioner(Omega_h_Partitioner partitioner) {
+  /* hints from one kind of RIB don't apply to the other */
+  if (partitioner != partitioner_) rib_hints_.reset();
+  partitioner_ = partitioner;
+}
+
+Int Mesh::parts_per_rank() const { return parts_per_rank_; }
+
+void Mesh::set_parts_per_rank(Int nparts) {
+  CHECK(nparts >= 1);
+  parts_per_rank_ = nparts;
+}
+
+void Mesh::set_tag_function(std::string const& name, TagFunction f) {
+  auto tagbase = get_tagbase(VERT, name);
+  CHECK(tagbase->type() == OMEGA_H_F64);
+  CHECK(tagbase->xfer() == OMEGA_H_LINEAR_INTERP ||
+        tagbase->xfer() == OMEGA_H_METRIC);
+  set_tag(VERT, name, f(coords()));
+  tag_functions_[name] = f;
+}
+
+bool Mesh::has_tag_function(std::string const& name) const {
+  return tag_functions_.count(name) != 0;
+}
+
+Mesh::TagFunction Mesh::get_tag_function(std::string const& name) const {
+  auto it = tag_functions_.find(name);
+  CHECK(it != tag_functions_.end());
+  return it->second;
+}
+
 #define INST_T(T)                                                              \
   template Tag<T> const* Mesh::get_tag<T>(Int dim, std::string const& name)    \
       const;                                                                   \
@@ -2,12 +2,14 @@
 
 #include <iostream>
 
+#include "array.hpp"
 #include "loop.hpp"
 #include "map.hpp"
 #include "owners.hpp"
 #include "remotes.hpp"
 #include "scan.hpp"
 #include "simplices.hpp"
+#include "sort.hpp"
 #include "tag.hpp"
 
 namespace Omega_h {
@@ -136,9 +138,115 @@ void push_tags(Mesh const* old_mesh, Mesh* new_mesh, Int ent_dim,
   }
 }
 
-void push_ents(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
-    Dist new_ents2old_owners, Dist old_owners2new_ents, Omega_h_Parting mode) {
-  push_tags(old_mesh, new_mesh, ent_dim, old_owners2new_ents);
+/* for each new entity, the old entity on the same rank that is a
+   copy of it, or (-1) if the new entity arrives from elsewhere.
+   copies are matched by their old owner */
+static LOs find_local_copies(
+    Mesh* old_mesh, Int ent_dim, Remotes new_owners) {
+  auto old_owners = old_mesh->ask_owners(ent_dim);
+  auto nold = old_mesh->nents(ent_dim);
+  auto nnew = new_owners.ranks.size();
+  Write<I64> old_keys(nold);
+  auto f = LAMBDA(LO i) {
+    old_keys[i] = (I64(old_owners.ranks[i]) << 32) | I64(old_owners.idxs[i]);
+  };
+  parallel_for(nold, f);
+  auto perm = sort_by_keys(Read<I64>(old_keys));
+  auto sorted_keys = unmap(perm, Read<I64>(old_keys), 1);
+  Write<LO> new2old(nnew);
+  auto g = LAMBDA(LO i) {
+    auto key = (I64(new_owners.ranks[i]) << 32) | I64(new_owners.idxs[i]);
+    LO l = 0;
+    LO r = nold;
+    while (l < r) {
+      auto m = (l + r) / 2;
+      if (sorted_keys[m] < key) {
+        l = m + 1;
+      } else {
+        r = m;
+      }
+    }
+    new2old[i] = (l < nold && sorted_keys[l] == key) ? perm[l] : -1;
+  };
+  parallel_for(nnew, g);
+  return new2old;
+}
+
+/* as above, but only the owners themselves count as copies */
+static LOs find_local_owners(CommPtr comm, Remotes new_owners) {
+  auto rank = comm->rank();
+  auto nnew = new_owners.ranks.size();
+  Write<LO> new2old(nnew);
+  auto f = LAMBDA(LO i) {
+    new2old[i] = (new_owners.ranks[i] == rank) ? new_owners.idxs[i] : -1;
+  };
+  parallel_for(nnew, f);
+  return new2old;
+}
+
+template <typename T>
+static void push_tag_delta(Mesh* new_mesh, Int ent_dim, TagBase const* tag,
+    Read<T> array, LOs kept, LOs kept2old, LOs arriving,
+    Dist old_owners2arriving) {
+  auto ncomps = tag->ncomps();
+  Write<T> new_array(new_mesh->nents(ent_dim) * ncomps);
+  map_into(unmap(kept2old, array, ncomps), kept, new_array, ncomps);
+  map_into(old_owners2arriving.exch(array, ncomps), arriving, new_array,
+      ncomps);
+  new_mesh->add_tag<T>(ent_dim, tag->name(), ncomps, tag->xfer(),
+      tag->outflags(), Read<T>(new_array));
+}
+
+/* like push_tags, but new entities which already had a copy on
+   their rank take their values from that copy, so that only
+   values of arriving entities are communicated.
+   the copies of an element-based mesh are trusted to agree with
+   their owners. ghost copies may hold values that only their
+   owners can correct, so other partings only reuse the owners */
+static void push_tags_delta(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
+    Dist old_owners2new_ents) {
+  auto comm = old_mesh->comm();
+  auto nold = old_mesh->nents(ent_dim);
+  auto new_owners = old_owners2new_ents.exch(
+      Remotes(Read<I32>(nold, comm->rank()), LOs(nold, 0, 1)), 1);
+  LOs new2old;
+  if (old_mesh->parting() == OMEGA_H_ELEM_BASED) {
+    new2old = find_local_copies(old_mesh, ent_dim, new_owners);
+  } else {
+    new2old = find_local_owners(comm, new_owners);
+  }
+  auto kept = collect_marked(each_neq_to(new2old, -1));
+  auto kept2old = unmap(kept, new2old, 1);
+  auto arriving = collect_marked(each_eq_to(new2old, -1));
+  auto arriving2old_owners =
+      Dist(comm, unmap(arriving, new_owners), old_mesh->nents(ent_dim));
+  auto old_owners2arriving = arriving2old_owners.invert();
+  for (Int i = 0; i < old_mesh->ntags(ent_dim); ++i) {
+    auto tag = old_mesh->get_tag(ent_dim, i);
+    if (is<I8>(tag)) {
+      push_tag_delta(new_mesh, ent_dim, tag, to<I8>(tag)->array(), kept,
+          kept2old, arriving, old_owners2arriving);
+    } else if (is<I32>(tag)) {
+      push_tag_delta(new_mesh, ent_dim, tag, to<I32>(tag)->array(), kept,
+          kept2old, arriving, old_owners2arriving);
+    } else if (is<I64>(tag)) {
+      push_tag_delta(new_mesh, ent_dim, tag, to<I64>(tag)->array(), kept,
+          kept2old, arriving, old_owners2arriving);
+    } else if (is<Real>(tag)) {
+      push_tag_delta(new_mesh, ent_dim, tag, to<Real>(tag)->array(), kept,
+          kept2old, arriving, old_owners2arriving);
+    }
+  }
+}
+
+static void push_ents(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
+    Dist new_ents2old_owners, Dist old_owners2new_ents, Omega_h_Parting mode,
+    bool reuses_copies) {
+  if (reuses_copies) {
+    push_tags_delta(old_mesh, new_mesh, ent_dim, old_owners2new_ents);
+  } else {
+    push_tags(old_mesh, new_mesh, ent_dim, old_owners2new_ents);
+  }
   Read<I32> own_ranks;
   if ((mode == OMEGA_H_GHOSTED) ||
       ((mode == OMEGA_H_VERT_BASED) && (ent_dim == VERT))) {
@@ -149,6 +257,12 @@ void push_ents(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
   new_mesh->set_owners(ent_dim, owners);
 }
 
+void push_ents(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
+    Dist new_ents2old_owners, Dist old_owners2new_ents, Omega_h_Parting mode) {
+  push_ents(old_mesh, new_mesh, ent_dim, new_ents2old_owners,
+      old_owners2new_ents, mode, false);
+}
+
 static void print_migrate_stats(CommPtr comm, Dist new_elems2old_owners) {
   auto msgs2ranks = new_elems2old_owners.msgs2ranks();
   auto msgs2content = new_elems2old_owners.msgs2content();
@@ -171,8 +285,10 @@ static void print_migrate_stats(CommPtr comm, Dist new_elems2old_owners) {
   }
 }
 
-void migrate_mesh(Mesh* old_mesh, Mesh* new_mesh, Dist new_elems2old_owners,
-    Omega_h_Parting mode, bool verbose) {
+static void migrate_mesh(Mesh* old_mesh, Mesh* new_mesh,
+    Dist new_elems2old_owners, Omega_h_Parting mode, bool verbose,
+    bool reuses_copies) {
+  CommPhase phase("migration");
   auto comm = old_mesh->comm();
   auto dim = old_mesh->dim();
   if (verbose) print_migrate_stats(comm, new_elems2old_owners);
@@ -185,15 +301,20 @@ void migrate_mesh(Mesh* old_mesh, Mesh* new_mesh, Dist new_elems2old_owners,
         old_low_owners2new_lows);
     new_mesh->set_ents(d, high2low);
     new_ents2old_owners = old_owners2new_ents.invert();
-    push_ents(
-        old_mesh, new_mesh, d, new_ents2old_owners, old_owners2new_ents, mode);
+    push_ents(old_mesh, new_mesh, d, new_ents2old_owners, old_owners2new_ents,
+        mode, reuses_copies);
     old_owners2new_ents = old_low_owners2new_lows;
   }
   auto new_verts2old_owners = old_owners2new_ents.invert();
   auto nnew_verts = new_verts2old_owners.nitems();
   new_mesh->set_verts(nnew_verts);
   push_ents(old_mesh, new_mesh, VERT, new_verts2old_owners, old_owners2new_ents,
-      mode);
+      mode, reuses_copies);
+}
+
+void migrate_mesh(Mesh* old_mesh, Mesh* new_mesh, Dist new_elems2old_owners,
+    Omega_h_Parting mode, bool verbose) {
+  migrate_mesh(old_mesh, new_mesh, new_elems2old_owners, mode, verbose, false);
 }
 
 void migrate_mesh(Mesh* mesh, Dist new_elems2old_owners, bool verbose) {
@@ -208,4 +329,18 @@ void migrate_mesh(Mesh* mesh, Remotes new_elems2old_owners, bool verbose) {
       mesh, Dist(mesh->comm(), new_elems2old_owners, mesh->nelems()), verbose);
 }
 
+void migrate_mesh_delta(Mesh* old_mesh, Mesh* new_mesh,
+    Dist new_elems2old_owners, Omega_h_Parting mode, bool verbose) {
+  migrate_mesh(old_mesh, new_mesh, new_elems2old_owners, mode, verbose, true);
+}
+
+void migrate_mesh_delta(
+    Mesh* mesh, Remotes new_elems2old_owners, bool verbose) {
+  auto new_mesh = mesh->copy_meta();
+  migrate_mesh_delta(mesh, &new_mesh,
+      Dist(mesh->comm(), new_elems2old_owners, mesh->nelems()),
+      OMEGA_H_ELEM_BASED, verbose);
+  *mesh = new_mesh;
+}
+
 }  // end namespace Omega_h
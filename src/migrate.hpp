@@ -39,6 +39,16 @@ void migrate_mesh(Mesh* old_mesh, Mesh* new_mesh, Dist new_elems2old_owners,
     Omega_h_Parting mode, bool verbose);
 void migrate_mesh(Mesh* mesh, Dist new_elems2old_owners, bool verbose);
 void migrate_mesh(Mesh* mesh, Remotes new_elems2old_owners, bool verbose);
+/* same as above, except that the tags of entities which already
+   have a copy on their new rank are copied locally rather than
+   sent by their owners. only departing and arriving entities
+   move their tag data, which makes small rebalances and ghosting
+   changes cheap. any copy is reused when the old mesh is element
+   based, which requires its copies to agree on tag values.
+   otherwise only copies that are the owners are reused */
+void migrate_mesh_delta(Mesh* old_mesh, Mesh* new_mesh,
+    Dist new_elems2old_owners, Omega_h_Parting mode, bool verbose);
+void migrate_mesh_delta(Mesh* mesh, Remotes new_elems2old_owners, bool verbose);
 
 }  // end namespace Omega_h
 
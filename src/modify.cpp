@@ -10,13 +10,113 @@
 #include "owners.hpp"
 #include "scan.hpp"
 #include "simplices.hpp"
+#include "sort.hpp"
 #include "unmap_mesh.hpp"
 
 namespace Omega_h {
 
+/* the distinct values of (a) that are not negative, sorted */
+static LOs sorted_unique(LOs a) {
+  auto perm = sort_by_keys(a);
+  auto sorted = unmap(perm, a, 1);
+  Write<I8> are_first(sorted.size());
+  auto mark_first = LAMBDA(LO i) {
+    are_first[i] = (sorted[i] >= 0) && (i == 0 || sorted[i] != sorted[i - 1]);
+  };
+  parallel_for(sorted.size(), mark_first);
+  return unmap(collect_marked(Read<I8>(are_first)), sorted, 1);
+}
+
+/* the index of each of (values) in (sorted), which holds them all */
+static LOs find_sorted(LOs sorted, LOs values) {
+  Write<LO> out(values.size());
+  auto f = LAMBDA(LO i) {
+    LO l = 0;
+    LO r = sorted.size() - 1;
+    while (l < r) {
+      auto m = (l + r) / 2;
+      if (sorted[m] < values[i]) {
+        l = m + 1;
+      } else {
+        r = m;
+      }
+    }
+    out[i] = l;
+  };
+  parallel_for(values.size(), f);
+  return out;
+}
+
+/* the lows of products are either products themselves or lows of
+   the old elements around the keys. only those are collected, key
+   by key, and they and their vertices are numbered within the
+   cavities, so matching products to their lows takes time in
+   proportion to the cavities instead of the mesh */
+static Adj find_prods2new_lows(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
+    Int key_dim, LOs keys2kds, LOs prod_verts2verts, LOs old_lows2new_lows,
+    LOs low_prods2new_lows) {
+  auto low_dim = ent_dim - 1;
+  auto elem_dim = old_mesh->dim();
+  auto kds2elems = old_mesh->ask_up(key_dim, elem_dim);
+  auto kds2kd_elems = kds2elems.a2ab;
+  auto kd_elems2elems = kds2elems.ab2b;
+  auto elems2lows = old_mesh->ask_down(elem_dim, low_dim).ab2b;
+  auto nlows_per_elem = simplex_degrees[elem_dim][low_dim];
+  auto nkeys = keys2kds.size();
+  Write<LO> key_nlows(nkeys);
+  auto count_lows = LAMBDA(LO key) {
+    auto kd = keys2kds[key];
+    key_nlows[key] = (kds2kd_elems[kd + 1] - kds2kd_elems[kd]) * nlows_per_elem;
+  };
+  parallel_for(nkeys, count_lows);
+  auto keys2key_lows = offset_scan(LOs(key_nlows));
+  auto nkey_lows = keys2key_lows.last();
+  auto nlow_prods = low_prods2new_lows.size();
+  Write<LO> uses2new_lows(nkey_lows + nlow_prods);
+  auto gather_lows = LAMBDA(LO key) {
+    auto kd = keys2kds[key];
+    auto key_low = keys2key_lows[key];
+    for (auto kd_elem = kds2kd_elems[kd]; kd_elem < kds2kd_elems[kd + 1];
+         ++kd_elem) {
+      auto elem = kd_elems2elems[kd_elem];
+      for (Int elem_low = 0; elem_low < nlows_per_elem; ++elem_low) {
+        auto old_low = elems2lows[elem * nlows_per_elem + elem_low];
+        uses2new_lows[key_low++] = old_lows2new_lows[old_low];
+      }
+    }
+  };
+  parallel_for(nkeys, gather_lows);
+  map_into(low_prods2new_lows, LOs(nlow_prods, nkey_lows, 1), uses2new_lows,
+      1);
+  auto cav_lows2new_lows = sorted_unique(LOs(uses2new_lows));
+  auto cav_low_verts2new_verts = LOs();
+  if (low_dim == EDGE) {
+    cav_low_verts2new_verts =
+        unmap(cav_lows2new_lows, new_mesh->ask_verts_of(EDGE), 2);
+  } else {
+    /* the new mesh has not derived its triangle vertices yet */
+    auto new_lows2new_edges = new_mesh->ask_down(low_dim, EDGE);
+    auto cav_lows2new_edges =
+        Adj(unmap(cav_lows2new_lows, new_lows2new_edges.ab2b, 3),
+            unmap(cav_lows2new_lows, new_lows2new_edges.codes, 3));
+    cav_low_verts2new_verts = transit(cav_lows2new_edges,
+        new_mesh->ask_down(EDGE, VERT), low_dim, VERT).ab2b;
+  }
+  auto cav_verts2new_verts = sorted_unique(cav_low_verts2new_verts);
+  auto cav_low_verts2cav_verts =
+      find_sorted(cav_verts2new_verts, cav_low_verts2new_verts);
+  auto prod_verts2cav_verts =
+      find_sorted(cav_verts2new_verts, prod_verts2verts);
+  auto prods2cav_lows = reflect_down(prod_verts2cav_verts,
+      cav_low_verts2cav_verts, cav_verts2new_verts.size(), ent_dim, low_dim);
+  return Adj(
+      unmap(prods2cav_lows.ab2b, cav_lows2new_lows, 1), prods2cav_lows.codes);
+}
+
 static void modify_conn(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
-    LOs prod_verts2verts, LOs prods2new_ents, LOs same_ents2old_ents,
-    LOs same_ents2new_ents, LOs old_lows2new_lows) {
+    Int key_dim, LOs keys2kds, LOs prod_verts2verts, LOs prods2new_ents,
+    LOs same_ents2old_ents, LOs same_ents2new_ents, LOs old_lows2new_lows,
+    LOs low_prods2new_lows) {
   auto low_dim = ent_dim - 1;
   auto down_degree = simplex_degrees[ent_dim][low_dim];
   auto old_ents2old_lows = old_mesh->ask_down(ent_dim, low_dim);
@@ -27,10 +127,8 @@ static void modify_conn(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
       compound_maps(same_ent_lows2old_lows, old_lows2new_lows);
   auto prods2new_lows = Adj();
   if (low_dim > VERT) {
-    auto new_low_verts2new_verts = new_mesh->ask_verts_of(low_dim);
-    auto new_verts2new_lows = new_mesh->ask_up(VERT, low_dim);
-    prods2new_lows = reflect_down(prod_verts2verts, new_low_verts2new_verts,
-        new_verts2new_lows, ent_dim, low_dim);
+    prods2new_lows = find_prods2new_lows(old_mesh, new_mesh, ent_dim, key_dim,
+        keys2kds, prod_verts2verts, old_lows2new_lows, low_prods2new_lows);
   } else {
     prods2new_lows = Adj(prod_verts2verts);
   }
@@ -301,8 +399,8 @@ static void modify_globals(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
 
 void modify_ents(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim, Int key_dim,
     LOs keys2kds, LOs keys2prods, LOs prod_verts2verts, LOs old_lows2new_lows,
-    LOs* p_prods2new_ents, LOs* p_same_ents2old_ents, LOs* p_same_ents2new_ents,
-    LOs* p_old_ents2new_ents) {
+    LOs low_prods2new_lows, LOs* p_prods2new_ents, LOs* p_same_ents2old_ents,
+    LOs* p_same_ents2new_ents, LOs* p_old_ents2new_ents) {
   *p_same_ents2old_ents = collect_same(old_mesh, ent_dim, key_dim, keys2kds);
   auto nkeys = keys2kds.size();
   CHECK(nkeys == keys2prods.size() - 1);
@@ -328,9 +426,9 @@ void modify_ents(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim, Int key_dim,
   if (ent_dim == VERT) {
     new_mesh->set_verts(nnew_ents);
   } else {
-    modify_conn(old_mesh, new_mesh, ent_dim, prod_verts2verts,
-        *p_prods2new_ents, *p_same_ents2old_ents, *p_same_ents2new_ents,
-        old_lows2new_lows);
+    modify_conn(old_mesh, new_mesh, ent_dim, key_dim, keys2kds,
+        prod_verts2verts, *p_prods2new_ents, *p_same_ents2old_ents,
+        *p_same_ents2new_ents, old_lows2new_lows, low_prods2new_lows);
   }
   if (old_mesh->comm()->size() > 1) {
     modify_owners(old_mesh, new_mesh, ent_dim, *p_prods2new_ents,
@@ -347,6 +445,21 @@ void modify_ents(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim, Int key_dim,
   }
 }
 
+void release_for_modify(Mesh* mesh) { mesh->remove_neighbor_caches(); }
+
+void release_modified_dim(Mesh* old_mesh, Int ent_dim, Int key_dim) {
+  /* elements are released with the whole old mesh, and the tags of
+     the keys' dimension are inherited by products of all dimensions */
+  if (ent_dim == old_mesh->dim()) return;
+  for (Int low_dim = VERT; low_dim < ent_dim; ++low_dim) {
+    old_mesh->remove_adj(low_dim, ent_dim);
+  }
+  if (ent_dim <= key_dim || ent_dim == VERT) return;
+  while (old_mesh->ntags(ent_dim)) {
+    old_mesh->remove_tag(ent_dim, old_mesh->get_tag(ent_dim, 0)->name());
+  }
+}
+
 void set_owners_by_indset(Mesh* mesh, Int key_dim, LOs keys2kds) {
   if (mesh->comm()->size() == 1) return;
   auto kd_owners = mesh->ask_owners(key_dim);
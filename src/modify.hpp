@@ -7,10 +7,20 @@ namespace Omega_h {
 
 LOs get_edge2rep_order(Mesh* mesh, Read<I8> edges_are_keys);
 
+/* (old_lows2new_lows) and (low_prods2new_lows) are what this
+   returned for the dimension below, so that only the cavities
+   are searched for the lows of new entities */
 void modify_ents(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim, Int key_dim,
     LOs keys2kds, LOs keys2prods, LOs prod_verts2verts, LOs old_lows2new_lows,
-    LOs* p_prods2new_ents, LOs* p_same_ents2old_ents, LOs* p_same_ents2new_ents,
-    LOs* p_old_ents2new_ents);
+    LOs low_prods2new_lows, LOs* p_prods2new_ents, LOs* p_same_ents2old_ents,
+    LOs* p_same_ents2new_ents, LOs* p_old_ents2new_ents);
+
+/* drops what (mesh) caches that modifying it does not use */
+void release_for_modify(Mesh* mesh);
+/* once (ent_dim) of the new mesh is done, drops the old mesh's
+   tags and upward adjacencies into (ent_dim) that modifying the
+   higher dimensions does not use */
+void release_modified_dim(Mesh* old_mesh, Int ent_dim, Int key_dim);
 
 void set_owners_by_indset(Mesh* mesh, Int key_dim, LOs keys2kds);
 
@@ -132,6 +132,42 @@ static void test_two_ranks_exch_sum(CommPtr comm) {
   }
 }
 
+static void test_two_ranks_nbx(CommPtr comm) {
+  auto nbx_comm = comm->dup();
+  nbx_comm->use_nbx(true);
+  test_two_ranks_dist(nbx_comm);
+  test_two_ranks_exch_sum(nbx_comm);
+  /* identical communication patterns share one graph communicator */
+  auto other = 1 - comm->rank();
+  auto remotes = Remotes(Read<I32>({other, other}), LOs({0, 1}));
+  auto dist1 = Dist(nbx_comm, remotes, 2);
+  auto dist2 = Dist(nbx_comm, remotes, 2);
+  CHECK(dist1.comm() == dist2.comm());
+  CHECK(dist1.invert().comm() == dist2.invert().comm());
+  CHECK(dist1.comm()->sources() == Read<I32>({other}));
+  CHECK(dist2.exch(LOs({comm->rank(), 7}), 1) == LOs({other, 7}));
+  /* the graph communicator based discovery is still available */
+  auto dense_comm = comm->dup();
+  dense_comm->use_nbx(false);
+  test_two_ranks_dist(dense_comm);
+}
+
+static void test_two_ranks_large_messages(CommPtr comm) {
+  /* pretend messages over 16 bytes are large, so they get
+     split into blocks of two doubles plus a remainder */
+  auto old_limit = max_message_bytes();
+  set_max_message_bytes(16);
+  test_two_ranks_dist(comm);
+  auto other = 1 - comm->rank();
+  auto dist = Dist(comm, Remotes(Read<I32>(3, other), LOs({2, 0, 1})), 3);
+  auto a = Reals({0, 1, 2, 3, 4, 5, 6, 7, 8});
+  if (comm->rank() == 1) a = add_to_each(a, 9.0);
+  auto b = dist.exch(a, 3);
+  auto offset = (other == 1) ? 9.0 : 0.0;
+  CHECK(b == add_to_each(Reals({3, 4, 5, 6, 7, 8, 0, 1, 2}), offset));
+  set_max_message_bytes(old_limit);
+}
+
 static void test_two_ranks_owners(CommPtr comm) {
   test_two_ranks_eq_owners(comm);
   test_two_ranks_uneq_owners(comm);
@@ -196,14 +232,44 @@ static void test_read_vtu(Library const& lib, CommPtr comm) {
   CHECK(OMEGA_H_SAME == compare_meshes(&mesh0, &mesh1, 0.0, 0.0, true, false));
 }
 
+static void test_predictive_balance(Library const& lib, CommPtr comm) {
+  Mesh mesh;
+  if (comm->rank() == 0) {
+    build_box(&mesh, lib, 4, 1, 0, 64, 4, 0);
+    auto coords = mesh.coords();
+    Write<Real> size(mesh.nverts());
+    auto f = LAMBDA(LO v) { size[v] = 0.02 + 0.05 * coords[v * 2]; };
+    parallel_for(mesh.nverts(), f);
+    mesh.add_tag(VERT, "size", 1, OMEGA_H_LINEAR_INTERP, OMEGA_H_DO_OUTPUT,
+        Reals(size));
+  }
+  mesh.set_comm(comm);
+  CHECK(are_close(mesh.imbalance(), Real(comm->size())));
+  mesh.balance(true);
+  CHECK(mesh.imbalance(true) < 1.1);
+  CHECK(mesh.imbalance() > 1.5);
+  auto work = expected_elems_per_elem_iso(
+      &mesh, mesh.get_array<Real>(VERT, "size"));
+  auto my_work = repro_sum(work);
+  auto max_work = comm->allreduce(my_work, OMEGA_H_MAX);
+  auto min_work = comm->allreduce(my_work, OMEGA_H_MIN);
+  CHECK(are_close(min_work, max_work, 0.1));
+  auto max_elems = comm->allreduce(mesh.nelems(), OMEGA_H_MAX);
+  auto min_elems = comm->allreduce(mesh.nelems(), OMEGA_H_MIN);
+  CHECK(min_elems < max_elems);
+}
+
 static void test_two_ranks(Library const& lib, CommPtr comm) {
   test_two_ranks_dist(comm);
   test_two_ranks_owners(comm);
   test_two_ranks_bipart(comm);
   test_two_ranks_exch_sum(comm);
+  test_two_ranks_nbx(comm);
+  test_two_ranks_large_messages(comm);
   test_resolve_derived(comm);
   test_construct(comm);
   test_read_vtu(lib, comm);
+  test_predictive_balance(lib, comm);
 }
 
 static void test_rib(CommPtr comm) {
@@ -220,12 +286,21 @@ static void test_rib(CommPtr comm) {
   auto owners = Remotes(Read<I32>(n, rank), LOs(n, 0, 1));
   auto out = inertia::recursively_bisect(
       comm, coords, masses, owners, 0.01, inertia::Rib());
-  I32 size2 = 1;
+  /* with (size) not a power of two, ranks end up at different depths */
+  I32 depth = 0;
+  for (I32 nranks = size, r = rank; nranks > 1; ++depth) {
+    auto nlow = nranks / 2;
+    if (r < nlow) {
+      nranks = nlow;
+    } else {
+      nranks -= nlow;
+      r -= nlow;
+    }
+  }
   for (auto axis : out.axes) {
     CHECK(are_close(axis, vector_3(1, 0, 0)));
-    size2 *= 2;
   }
-  CHECK(size2 == size);
+  CHECK(I32(out.axes.size()) == depth);
   auto check_coords = LAMBDA(LO i) {
     auto v = get_vector<3>(coords, i);
     CHECK(rank * n <= v[0]);
@@ -236,6 +311,481 @@ static void test_rib(CommPtr comm) {
   CHECK(masses == Reals(n, 1));
 }
 
+static void test_node_rib(Library const& lib, CommPtr comm) {
+  std::vector<I32> node_sizes;
+  auto grouped = comm->group_by_node(&node_sizes);
+  CHECK(grouped->size() == comm->size());
+  I32 nranks = 0;
+  for (auto node_size : node_sizes) nranks += node_size;
+  CHECK(nranks == comm->size());
+  if (comm->size() == 4) {
+    /* pretend the last rank is on a node of its own */
+    auto rank = comm->rank();
+    LO n = 5;
+    Write<Real> w_coords(n * 3);
+    auto set_coords = LAMBDA(LO i) {
+      set_vector(w_coords, i, vector_3(i * 4 + rank, 0, 0));
+    };
+    parallel_for(n, set_coords);
+    Reals coords(w_coords);
+    Reals masses(n, 1);
+    auto owners = Remotes(Read<I32>(n, rank), LOs(n, 0, 1));
+    auto out = inertia::recursively_bisect(comm, coords, masses, owners,
+        0.01, inertia::Rib(), std::vector<I32>({3, 1}));
+    I32 const depths[4] = {2, 3, 3, 1};
+    CHECK(I32(out.axes.size()) == depths[rank]);
+    auto check_coords = LAMBDA(LO i) {
+      auto v = get_vector<3>(coords, i);
+      CHECK(rank * n <= v[0]);
+      CHECK(v[0] < (rank + 1) * n);
+    };
+    parallel_for(n, check_coords);
+  }
+  Mesh mesh;
+  if (comm->rank() == 0) {
+    build_box(&mesh, lib, 1, 1, 1, 4, 4, 4);
+  }
+  mesh.set_comm(comm);
+  mesh.set_partitioner(OMEGA_H_NODE_RIB);
+  mesh.balance();
+  CHECK(mesh.imbalance() < 1.1);
+  auto nelems = comm->allreduce(GO(mesh.nelems()), OMEGA_H_SUM);
+  CHECK(nelems == 4 * 4 * 4 * 6);
+}
+
+static void test_overdecomposition(Library const& lib, CommPtr comm) {
+  Mesh mesh;
+  if (comm->rank() == 0) {
+    build_box(&mesh, lib, 1, 1, 1, 4, 4, 4);
+    mesh.add_tag(TET, "part", 1, OMEGA_H_INHERIT, OMEGA_H_DO_OUTPUT,
+        Read<I32>(mesh.nelems(), -1));
+  }
+  mesh.set_comm(comm);
+  mesh.set_parts_per_rank(4);
+  mesh.balance();
+  CHECK(mesh.imbalance() < 1.25);
+  /* a user tag of the same name is left alone */
+  CHECK(mesh.get_array<I32>(TET, "part") == Read<I32>(mesh.nelems(), -1));
+  auto parts = mesh.get_array<I32>(mesh.dim(), "omega_h_part");
+  CHECK(max(comm, parts) + 1 == 4 * comm->size());
+  /* balanced parts stay where they are */
+  auto nelems = mesh.nelems();
+  auto part_sum = sum(parts);
+  mesh.balance();
+  CHECK(mesh.nelems() == nelems);
+  CHECK(sum(mesh.get_array<I32>(mesh.dim(), "omega_h_part")) == part_sum);
+}
+
+static void test_delta_migration(Library const& lib, CommPtr comm) {
+  Mesh mesh;
+  if (comm->rank() == 0) {
+    build_box(&mesh, lib, 1, 1, 1, 4, 4, 4);
+  }
+  mesh.set_comm(comm);
+  mesh.balance();
+  /* each rank sends a tenth of its elements to the next rank */
+  auto nelems = mesh.nelems();
+  Write<I32> dest_ranks(nelems);
+  auto rank = comm->rank();
+  auto size = comm->size();
+  auto f = LAMBDA(LO e) {
+    dest_ranks[e] = (e < nelems / 10) ? ((rank + 1) % size) : rank;
+  };
+  parallel_for(nelems, f);
+  Dist dist;
+  dist.set_parent_comm(comm);
+  dist.set_dest_ranks(dest_ranks);
+  auto owners = dist.exch(mesh.ask_owners(mesh.dim()), 1);
+  auto full = mesh;
+  migrate_mesh(&full, owners, false);
+  auto delta = mesh;
+  migrate_mesh_delta(&delta, owners, false);
+  CHECK(full == delta);
+  CHECK(full.coords() == delta.coords());
+  /* ghosting also only sends what changes ranks */
+  auto ghosted = delta;
+  ghosted.set_parting(OMEGA_H_GHOSTED);
+  ghosted.set_parting(OMEGA_H_ELEM_BASED);
+  CHECK(ghosted == delta);
+  /* but stale ghost copies are replaced by their owners' values */
+  ghosted.set_parting(OMEGA_H_GHOSTED);
+  ghosted.add_tag(VERT, "stale", 1, OMEGA_H_DONT_TRANSFER,
+      OMEGA_H_DONT_OUTPUT, ghosted.owned(VERT));
+  ghosted.set_parting(OMEGA_H_ELEM_BASED);
+  CHECK(ghosted.get_array<I8>(VERT, "stale") ==
+        Read<I8>(ghosted.nverts(), 1));
+}
+
+static Read<I8> mark_low_verts(Mesh* mesh, Real x) {
+  auto coords = mesh->coords();
+  auto dim = mesh->dim();
+  Write<I8> marks(mesh->nverts());
+  auto f = LAMBDA(LO v) { marks[v] = (coords[v * dim] < x); };
+  parallel_for(mesh->nverts(), f);
+  return marks;
+}
+
+static LO count_center_uses(Mesh* mesh, Read<I8> verts_are_centers) {
+  auto degrees = HostRead<LO>(
+      get_degrees(mesh->ask_up(VERT, mesh->dim()).a2ab));
+  auto owned = HostRead<I8>(mesh->owned(VERT));
+  auto centers = HostRead<I8>(verts_are_centers);
+  LO n = 0;
+  for (LO v = 0; v < mesh->nverts(); ++v) {
+    if (owned[v] && centers[v]) n += degrees[v];
+  }
+  return mesh->comm()->allreduce(n, OMEGA_H_SUM);
+}
+
+static void test_partial_ghosting(Library const& lib, CommPtr comm) {
+  Mesh mesh;
+  if (comm->rank() == 0) {
+    build_box(&mesh, lib, 1, 1, 1, 4, 4, 4);
+  }
+  mesh.set_comm(comm);
+  mesh.balance();
+  auto full = mesh;
+  full.set_parting(OMEGA_H_GHOSTED);
+  auto partial = mesh;
+  partial.ghost_partially(mark_low_verts(&partial, 0.3));
+  CHECK(partial.parting() == OMEGA_H_GHOSTED);
+  /* owners of marked vertices see all their elements */
+  CHECK(count_center_uses(&partial, mark_low_verts(&partial, 0.3)) ==
+        count_center_uses(&full, mark_low_verts(&full, 0.3)));
+  CHECK(comm->allreduce(partial.nelems(), OMEGA_H_SUM) <=
+        comm->allreduce(full.nelems(), OMEGA_H_SUM));
+  /* full ghosting replaces partial ghosts */
+  auto upgraded = partial;
+  upgraded.set_parting(OMEGA_H_GHOSTED);
+  CHECK(upgraded.nelems() == full.nelems());
+  partial.set_parting(OMEGA_H_ELEM_BASED);
+  CHECK(partial == mesh);
+}
+
+/* whether each global number of (dim) names the same vertices in both
+   meshes, regardless of how the entities are oriented */
+static bool have_same_numbering(Mesh* a, Mesh* b, Int dim) {
+  auto comm = a->comm();
+  if (a->nglobal_ents(dim) != b->nglobal_ents(dim)) return false;
+  auto deg = dim + 1;
+  Read<GO> lin_verts[2];
+  Mesh* meshes[2] = {a, b};
+  for (Int i = 0; i < 2; ++i) {
+    auto m = meshes[i];
+    auto ev2vg = unmap(m->ask_verts_of(dim), m->ask_globals(VERT), 1);
+    Write<GO> sorted(ev2vg.size());
+    auto f = LAMBDA(LO e) {
+      for (Int j = 0; j < deg; ++j) {
+        auto g = ev2vg[e * deg + j];
+        auto k = j;
+        for (; k > 0 && sorted[e * deg + k - 1] > g; --k) {
+          sorted[e * deg + k] = sorted[e * deg + k - 1];
+        }
+        sorted[e * deg + k] = g;
+      }
+    };
+    parallel_for(m->nents(dim), f);
+    auto copies2lins = copies_to_linear_owners(comm, m->ask_globals(dim));
+    lin_verts[i] = reduce_data_to_owners(Read<GO>(sorted), copies2lins, deg);
+  }
+  return comm->reduce_and(lin_verts[0] == lin_verts[1]);
+}
+
+static void refine_low_by_templates(Mesh* mesh) {
+  auto edges_are_marked =
+      mark_up(mesh, VERT, EDGE, mark_low_verts(mesh, 0.3));
+  CHECK(refine_by_templates(mesh, edges_are_marked, false));
+}
+
+static void test_refine_by_templates(Library const& lib, CommPtr comm) {
+  Mesh serial;
+  build_box(&serial, lib, 1, 1, 1, 3, 3, 3);
+  Mesh mesh;
+  if (comm->rank() == 0) mesh = serial;
+  mesh.set_comm(comm);
+  mesh.balance();
+  refine_low_by_templates(&serial);
+  refine_low_by_templates(&mesh);
+  CHECK(comm->allreduce(GO(mesh.nelems()), OMEGA_H_SUM) == serial.nelems());
+  CHECK(sum(comm, mesh.owned(VERT)) == serial.nverts());
+  /* new vertex numbers do not depend on the partitioning */
+  CHECK(find_total_globals(comm, mesh.ask_globals(VERT)) == serial.nverts());
+  auto size = repro_sum_owned(&mesh, TET, measure_elements_real(&mesh));
+  CHECK(are_close(size, 1.0));
+  /* nor do the numbers of the other new entities */
+  Mesh before;
+  if (comm->rank() == 0) {
+    build_box(&before, lib, 1, 1, 1, 3, 3, 3);
+    refine_low_by_templates(&before);
+  }
+  before.set_comm(comm);
+  before.balance();
+  mesh.balance();
+  CHECK(OMEGA_H_SAME == compare_meshes(&before, &mesh, 0.0, 0.0, false, false));
+  for (Int dim = EDGE; dim <= mesh.dim(); ++dim) {
+    CHECK(have_same_numbering(&before, &mesh, dim));
+  }
+}
+
+static void test_refine_uniformly(Library const& lib, CommPtr comm) {
+  Mesh before;
+  Mesh after;
+  if (comm->rank() == 0) {
+    build_box(&before, lib, 1, 1, 1, 2, 2, 2);
+    after = before;
+    refine_uniformly(&before, 1);
+  }
+  before.set_comm(comm);
+  before.balance();
+  after.set_comm(comm);
+  after.balance();
+  refine_uniformly(&after, 1);
+  /* global numbers do not depend on where the mesh was refined */
+  CHECK(before == after);
+}
+
+/* counts the triangles whose vertices all have x <= cut (or >= cut) */
+static GO count_tris_beyond(Mesh* mesh, Real cut, bool below) {
+  auto xs = get_component(mesh->coords(), 2, 0);
+  auto verts_are_across = below ? each_gt(xs, cut) : each_lt(xs, cut);
+  auto tris_are_across = mark_up(mesh, VERT, TRI, verts_are_across);
+  return count_owned_marks(mesh, TRI, invert_marks(tris_are_across));
+}
+
+static void test_adapt_region(Library const& lib, CommPtr comm) {
+  Mesh mesh;
+  if (comm->rank() == 0) {
+    build_box(&mesh, lib, 1, 1, 0, 8, 8, 0);
+    classify_by_angles(&mesh, PI / 4);
+    mesh.add_tag(VERT, "size", 1, OMEGA_H_LINEAR_INTERP, OMEGA_H_DO_OUTPUT,
+        Reals(mesh.nverts(), 0.04));
+    auto xs = get_component(mesh.coords(), 2, 0);
+    auto tris_are_out = mark_up(&mesh, VERT, TRI, each_gt(xs, 0.26));
+    mesh.add_tag(TRI, "region", 1, OMEGA_H_INHERIT, OMEGA_H_DO_OUTPUT,
+        invert_marks(tris_are_out));
+  }
+  mesh.set_comm(comm);
+  mesh.balance();
+  auto nfar = count_tris_beyond(&mesh, 0.5, false);
+  auto nnear = count_tris_beyond(&mesh, 0.25, true);
+  AdaptStats stats;
+  AdaptOpts opts;
+  opts.verbosity = 0;
+  opts.region_name = "region";
+  opts.region_nlayers = 1;
+  opts.stats = &stats;
+  CHECK(adapt(&mesh, opts));
+  CHECK(!stats.passes.empty());
+  if (comm->size() > 1) CHECK(stats.passes.front().bytes_migrated > 0);
+  CHECK(stats.passes.back().nents_after[TRI] == mesh.nglobal_ents(TRI));
+  CHECK(count_tris_beyond(&mesh, 0.5, false) == nfar);
+  CHECK(count_tris_beyond(&mesh, 0.25, true) > 4 * nnear);
+}
+
+static void test_adapt_weights(Library const& lib, CommPtr comm) {
+  Mesh mesh;
+  if (comm->rank() == 0) {
+    build_box(&mesh, lib, 2, 1, 0, 16, 8, 0);
+    classify_by_angles(&mesh, PI / 4);
+    mesh.add_tag(VERT, "size", 1, OMEGA_H_LINEAR_INTERP, OMEGA_H_DO_OUTPUT,
+        Reals(mesh.nverts(), 0.04));
+    auto xs = get_component(mesh.coords(), 2, 0);
+    auto tris_are_left = mark_up(&mesh, VERT, TRI, each_lt(xs, 0.5));
+    Write<Real> work(mesh.ntris());
+    auto f = LAMBDA(LO tri) { work[tri] = tris_are_left[tri] ? 4.0 : 1.0; };
+    parallel_for(mesh.ntris(), f);
+    mesh.add_tag(
+        TRI, "work", 1, OMEGA_H_INHERIT, OMEGA_H_DO_OUTPUT, Reals(work));
+  }
+  mesh.set_comm(comm);
+  mesh.balance(mesh.get_array<Real>(TRI, "work"));
+  CHECK(mesh.imbalance(mesh.get_array<Real>(TRI, "work")) < 1.1);
+  if (comm->size() > 1) CHECK(mesh.imbalance() > 1.1);
+  mesh.balance();
+  AdaptStats stats;
+  AdaptOpts opts;
+  opts.verbosity = 0;
+  opts.max_imbalance = 1.2;
+  opts.weight_name = "work";
+  opts.stats = &stats;
+  CHECK(adapt(&mesh, opts));
+  /* rebalancing measures the given work, not the element counts */
+  if (comm->size() > 1) CHECK(stats.nrebalances > 0);
+  CHECK(mesh.imbalance(mesh.get_array<Real>(TRI, "work")) <= 1.2);
+}
+
+/* checks that every vertex within (nlayers - 1) element layers of the
+   rank's own elements has all its elements present */
+static void check_ghost_layers(Mesh* mesh, Int nlayers) {
+  auto dim = mesh->dim();
+  auto nverts_per_elem = simplex_degrees[dim][VERT];
+  auto v2e = mesh->ask_up(VERT, dim);
+  auto v2ve = HostRead<LO>(v2e.a2ab);
+  auto ve2e = HostRead<LO>(v2e.ab2b);
+  auto ev2v = HostRead<LO>(mesh->ask_elem_verts());
+  auto degrees = HostRead<LO>(mesh->get_array<LO>(VERT, "degree"));
+  auto owned = HostRead<I8>(mesh->owned(dim));
+  std::vector<I8> elem_marks(owned.size());
+  for (LO e = 0; e < mesh->nelems(); ++e) elem_marks[e] = owned[e];
+  for (Int layer = 0; layer < nlayers; ++layer) {
+    std::vector<I8> vert_marks(mesh->nverts(), 0);
+    for (LO e = 0; e < mesh->nelems(); ++e) {
+      if (!elem_marks[e]) continue;
+      for (Int i = 0; i < nverts_per_elem; ++i) {
+        vert_marks[ev2v[e * nverts_per_elem + i]] = 1;
+      }
+    }
+    for (LO v = 0; v < mesh->nverts(); ++v) {
+      if (!vert_marks[v]) continue;
+      CHECK(v2ve[v + 1] - v2ve[v] == degrees[v]);
+      for (auto ve = v2ve[v]; ve < v2ve[v + 1]; ++ve) {
+        elem_marks[ve2e[ve]] = 1;
+      }
+    }
+  }
+}
+
+static void test_ghost_layers(Library const& lib, CommPtr comm) {
+  Mesh mesh;
+  if (comm->rank() == 0) {
+    build_box(&mesh, lib, 1, 1, 1, 4, 4, 4);
+  }
+  mesh.set_comm(comm);
+  mesh.balance();
+  auto local_degrees = get_degrees(mesh.ask_up(VERT, mesh.dim()).a2ab);
+  auto degrees = mesh.sync_array(VERT,
+      mesh.reduce_array(VERT, local_degrees, 1, OMEGA_H_SUM), 1);
+  mesh.add_tag(VERT, "degree", 1, OMEGA_H_DONT_TRANSFER, OMEGA_H_DONT_OUTPUT,
+      degrees);
+  auto one = mesh;
+  one.set_parting(OMEGA_H_GHOSTED);
+  CHECK(one.nghost_layers() == 1);
+  check_ghost_layers(&one, 1);
+  auto two = mesh;
+  two.set_parting(OMEGA_H_GHOSTED, 2);
+  CHECK(two.nghost_layers() == 2);
+  check_ghost_layers(&two, 2);
+  CHECK(two.nelems() >= one.nelems());
+  /* existing layers satisfy a plain request for ghosts */
+  auto nelems = two.nelems();
+  two.set_parting(OMEGA_H_GHOSTED);
+  CHECK(two.nelems() == nelems);
+  two.set_parting(OMEGA_H_GHOSTED, 3);
+  check_ghost_layers(&two, 3);
+  two.set_parting(OMEGA_H_ELEM_BASED);
+  CHECK(two.nghost_layers() == 0);
+  CHECK(two == mesh);
+}
+
+static void test_hilbert_partition(Library const& lib, CommPtr comm) {
+  Mesh mesh;
+  if (comm->rank() == 0) {
+    build_box(&mesh, lib, 1, 1, 1, 4, 4, 4);
+  }
+  mesh.set_comm(comm);
+  mesh.set_partitioner(OMEGA_H_HILBERT);
+  mesh.balance();
+  CHECK(mesh.imbalance() < 1.1);
+  auto nelems = comm->allreduce(GO(mesh.nelems()), OMEGA_H_SUM);
+  CHECK(nelems == 4 * 4 * 4 * 6);
+  mesh.balance();
+  CHECK(mesh.imbalance() < 1.1);
+}
+
+/* the number of sides shared by elements on different ranks */
+static GO count_cut_sides(Mesh* mesh) {
+  auto comm = mesh->comm();
+  auto side_dim = mesh->dim() - 1;
+  auto ncopies = comm->allreduce(GO(mesh->nents(side_dim)), OMEGA_H_SUM);
+  return ncopies - mesh->nglobal_ents(side_dim);
+}
+
+static void test_multilevel_partition(Library const& lib, CommPtr comm) {
+  Mesh mesh;
+  if (comm->rank() == 0) {
+    build_box(&mesh, lib, 1, 1, 1, 4, 4, 4);
+  }
+  mesh.set_comm(comm);
+  /* dealing the elements out in turn is the trivial partition */
+  auto dealt = mesh;
+  Dist dist;
+  dist.set_parent_comm(comm);
+  auto size = comm->size();
+  Write<I32> dest_ranks(dealt.nelems());
+  auto f = LAMBDA(LO elem) { dest_ranks[elem] = elem % size; };
+  parallel_for(dealt.nelems(), f);
+  dist.set_dest_ranks(Read<I32>(dest_ranks));
+  migrate_mesh(&dealt, dist.exch(dealt.ask_owners(TET), 1), false);
+  mesh.set_partitioner(OMEGA_H_MULTILEVEL);
+  mesh.balance();
+  CHECK(mesh.imbalance() < 1.1);
+  auto nelems = comm->allreduce(GO(mesh.nelems()), OMEGA_H_SUM);
+  CHECK(nelems == 4 * 4 * 4 * 6);
+  /* the multilevel partition cuts far fewer sides */
+  auto dealt_cut = count_cut_sides(&dealt);
+  CHECK(4 * count_cut_sides(&mesh) <= dealt_cut);
+  /* dealt elements have almost no neighbors on their own rank,
+     so this relies on matching across rank boundaries */
+  dealt.set_partitioner(OMEGA_H_MULTILEVEL);
+  dealt.balance();
+  CHECK(dealt.imbalance() < 1.1);
+  CHECK(4 * count_cut_sides(&dealt) <= dealt_cut);
+}
+
+static void test_batched_allreduce(CommPtr comm) {
+  auto rank = comm->rank();
+  auto size = comm->size();
+  auto out = comm->allreduce(std::vector<GO>({GO(rank), GO(rank), GO(1)}),
+      std::vector<Omega_h_Op>({OMEGA_H_MIN, OMEGA_H_MAX, OMEGA_H_SUM}));
+  CHECK(out == std::vector<GO>({0, GO(size - 1), GO(size)}));
+  auto out2 = comm->allreduce(std::vector<Real>({-Real(rank), Real(rank)}),
+      std::vector<Omega_h_Op>({OMEGA_H_MAX, OMEGA_H_SUM}));
+  CHECK(out2[0] == 0.0);
+  CHECK(out2[1] == Real(size * (size - 1) / 2));
+}
+
+#ifdef OMEGA_H_USE_MPI
+static void test_comm_stats(CommPtr comm) {
+  reset_comm_stats();
+  {
+    CommPhase phase("outer");
+    comm->allreduce(I32(1), OMEGA_H_SUM);
+    {
+      CommPhase inner_phase("inner");
+      comm->barrier();
+    }
+  }
+  auto stats = get_comm_stats("outer");
+  CHECK(stats.ncalls == 1);
+  CHECK(stats.bytes_sent == I64(sizeof(I32)));
+  CHECK(get_comm_stats("inner").ncalls == 1);
+  auto other = (comm->rank() + 1) % comm->size();
+  auto dist = Dist(comm, Remotes(Read<I32>({other}), LOs({0})), 1);
+  {
+    CommPhase phase("exch");
+    dist.exch(Reals({1.0, 2.0}), 2);
+  }
+  stats = get_comm_stats("exch");
+  CHECK(stats.ncalls == 1);
+  if (comm->size() > 1) {
+    CHECK(stats.nmsgs_sent == 1);
+    CHECK(stats.nmsgs_recvd == 1);
+    CHECK(stats.bytes_sent == I64(2 * sizeof(Real)));
+    CHECK(stats.bytes_recvd == I64(2 * sizeof(Real)));
+    CHECK(stats.max_neighbors == 1);
+  }
+  std::stringstream stream;
+  print_comm_stats(comm, stream);
+  CHECK((comm->rank() == 0) == !stream.str().empty());
+  CHECK((comm->rank() == 0) ==
+        (stream.str().find("messages received") != std::string::npos));
+  if (comm->rank() == 0 && comm->size() > 1) {
+    /* every rank received the same, so average and maximum agree */
+    CHECK(stream.str().find("16 / 16 bytes received") != std::string::npos);
+  }
+}
+#endif
+
 int main(int argc, char** argv) {
   auto lib = Library(&argc, &argv);
   auto world = lib.world();
@@ -254,4 +804,26 @@ int main(int argc, char** argv) {
     }
   }
   test_rib(world);
+  if (world->size() >= 3) {
+    auto three = world->split(world->rank() / 3, world->rank() % 3);
+    if (world->rank() / 3 == 0) {
+      test_rib(three);
+    }
+  }
+  test_node_rib(lib, world);
+  test_overdecomposition(lib, world);
+  test_delta_migration(lib, world);
+  test_partial_ghosting(lib, world);
+  test_ghost_layers(lib, world);
+  test_refine_by_templates(lib, world);
+  test_refine_uniformly(lib, world);
+  test_adapt_region(lib, world);
+  test_adapt_weights(lib, world);
+  test_hilbert_partition(lib, world);
+  test_multilevel_partition(lib, world);
+  test_batched_allreduce(world);
+#ifdef OMEGA_H_USE_MPI
+  /* only calls into MPI are counted */
+  test_comm_stats(world);
+#endif
 }
@@ -0,0 +1,712 @@
+#include "multilevel.hpp"
+
+#include <map>
+#include <numeric>
+#include <queue>
+
+#include "array.hpp"
+#include "loop.hpp"
+#include "simplices.hpp"
+
+namespace Omega_h {
+
+namespace multilevel {
+
+/* a graph held by a single rank, with integer vertex and
+   edge weights so that weight sums are exact */
+struct HostGraph {
+  std::vector<I64> weights;
+  std::vector<LO> offsets;
+  std::vector<LO> adj;
+  std::vector<I64> adj_weights;
+  LO nverts() const { return LO(weights.size()); }
+};
+
+/* for each side of each element, the value (elem_values) takes
+   on the element across that side, or (-1) if there is none.
+   each side sums the values of its (at most two) elements
+   and counts them, so one exchange serves all sides
+   no matter which ranks their elements are on */
+static Read<I64> values_across_sides(Mesh* mesh, Read<I64> elem_values) {
+  auto dim = mesh->dim();
+  auto s2e = mesh->ask_up(dim - 1, dim);
+  auto s2se = s2e.a2ab;
+  auto se2e = s2e.ab2b;
+  auto nsides = mesh->nents(dim - 1);
+  Write<I64> side_data(nsides * 2);
+  auto f = LAMBDA(LO s) {
+    I64 count = 0;
+    I64 sum = 0;
+    for (auto se = s2se[s]; se < s2se[s + 1]; ++se) {
+      ++count;
+      sum += elem_values[se2e[se]];
+    }
+    side_data[s * 2 + 0] = count;
+    side_data[s * 2 + 1] = sum;
+  };
+  parallel_for(nsides, f);
+  auto totals =
+      mesh->reduce_array(dim - 1, Read<I64>(side_data), 2, OMEGA_H_SUM);
+  totals = mesh->sync_array(dim - 1, totals, 2);
+  auto es2s = mesh->ask_down(dim, dim - 1).ab2b;
+  auto nsides_per_elem = simplex_degrees[dim][dim - 1];
+  Write<I64> out(mesh->nelems() * nsides_per_elem);
+  auto g = LAMBDA(LO e) {
+    for (Int es = 0; es < nsides_per_elem; ++es) {
+      auto s = es2s[e * nsides_per_elem + es];
+      auto across = totals[s * 2 + 1] - elem_values[e];
+      out[e * nsides_per_elem + es] = (totals[s * 2] == 2) ? across : -1;
+    }
+  };
+  parallel_for(mesh->nelems(), g);
+  return out;
+}
+
+/* the part of the dual graph between elements of this rank */
+static HostGraph local_dual(
+    Read<I64> weights, Read<I64> nbr_ids, I64 first_id, Int nsides_per_elem) {
+  HostRead<I64> h_weights(weights);
+  HostRead<I64> h_nbr_ids(nbr_ids);
+  auto n = h_weights.size();
+  HostGraph g;
+  g.offsets.push_back(0);
+  for (LO e = 0; e < n; ++e) {
+    g.weights.push_back(h_weights[e]);
+    for (Int es = 0; es < nsides_per_elem; ++es) {
+      auto nbr = h_nbr_ids[e * nsides_per_elem + es];
+      if (first_id <= nbr && nbr < first_id + n) {
+        g.adj.push_back(LO(nbr - first_id));
+        g.adj_weights.push_back(1);
+      }
+    }
+    g.offsets.push_back(LO(g.adj.size()));
+  }
+  return g;
+}
+
+/* match each vertex with the unmatched neighbor it shares the
+   heaviest edge with, unless that would make a coarse vertex
+   heavier than (max_weight).
+   returns the number of coarse vertices */
+static LO match_heavy_edges(
+    HostGraph const& g, I64 max_weight, std::vector<LO>& fine2coarse) {
+  auto n = g.nverts();
+  std::vector<LO> match(std::size_t(n), -1);
+  for (LO v = 0; v < n; ++v) {
+    if (match[v] != -1) continue;
+    LO best = -1;
+    I64 best_weight = 0;
+    for (auto vu = g.offsets[v]; vu < g.offsets[v + 1]; ++vu) {
+      auto u = g.adj[vu];
+      if (match[u] != -1) continue;
+      if (g.weights[v] + g.weights[u] > max_weight) continue;
+      if (g.adj_weights[vu] > best_weight) {
+        best = u;
+        best_weight = g.adj_weights[vu];
+      }
+    }
+    if (best == -1) {
+      match[v] = v;
+    } else {
+      match[v] = best;
+      match[best] = v;
+    }
+  }
+  fine2coarse.assign(std::size_t(n), -1);
+  LO nc = 0;
+  for (LO v = 0; v < n; ++v) {
+    if (fine2coarse[v] != -1) continue;
+    fine2coarse[v] = nc;
+    fine2coarse[match[v]] = nc;
+    ++nc;
+  }
+  return nc;
+}
+
+static HostGraph contract(
+    HostGraph const& g, std::vector<LO> const& fine2coarse, LO nc) {
+  auto n = g.nverts();
+  std::vector<LO> c2cf(std::size_t(nc + 1), 0);
+  for (LO v = 0; v < n; ++v) ++c2cf[fine2coarse[v] + 1];
+  std::partial_sum(c2cf.begin(), c2cf.end(), c2cf.begin());
+  std::vector<LO> cf2f(static_cast<std::size_t>(n));
+  auto fill = c2cf;
+  for (LO v = 0; v < n; ++v) cf2f[fill[fine2coarse[v]]++] = v;
+  HostGraph c;
+  c.weights.assign(std::size_t(nc), 0);
+  c.offsets.push_back(0);
+  /* where in the current row each coarse neighbor is */
+  std::vector<LO> row_pos(std::size_t(nc), -1);
+  for (LO cv = 0; cv < nc; ++cv) {
+    auto row_start = LO(c.adj.size());
+    for (auto cf = c2cf[cv]; cf < c2cf[cv + 1]; ++cf) {
+      auto v = cf2f[cf];
+      c.weights[cv] += g.weights[v];
+      for (auto vu = g.offsets[v]; vu < g.offsets[v + 1]; ++vu) {
+        auto cu = fine2coarse[g.adj[vu]];
+        if (cu == cv) continue;
+        if (row_pos[cu] < row_start) {
+          row_pos[cu] = LO(c.adj.size());
+          c.adj.push_back(cu);
+          c.adj_weights.push_back(g.adj_weights[vu]);
+        } else {
+          c.adj_weights[row_pos[cu]] += g.adj_weights[vu];
+        }
+      }
+    }
+    c.offsets.push_back(LO(c.adj.size()));
+  }
+  return c;
+}
+
+/* breadth-first order of (verts), restarting from the next
+   unvisited vertex whenever a connected component runs out.
+   (state) must be zero for all vertices and is left that way */
+static std::vector<LO> bfs_order(HostGraph const& g,
+    std::vector<LO> const& verts, LO start, std::vector<I8>& state) {
+  enum { UNVISITED = 1, VISITED = 2 };
+  for (auto v : verts) state[v] = UNVISITED;
+  std::vector<LO> order;
+  auto visit = [&](LO v) {
+    state[v] = VISITED;
+    order.push_back(v);
+  };
+  visit(start);
+  std::size_t head = 0;
+  std::size_t next_seed = 0;
+  while (order.size() < verts.size()) {
+    if (head == order.size()) {
+      while (state[verts[next_seed]] != UNVISITED) ++next_seed;
+      visit(verts[next_seed]);
+    }
+    auto v = order[head++];
+    for (auto vu = g.offsets[v]; vu < g.offsets[v + 1]; ++vu) {
+      auto u = g.adj[vu];
+      if (state[u] == UNVISITED) visit(u);
+    }
+  }
+  for (auto v : verts) state[v] = 0;
+  return order;
+}
+
+/* grows a region from (seed), always adding the frontier vertex
+   that is most connected to the region, until it has (target)
+   weight. on return (state) marks the region as INSIDE and the
+   rest of (verts) as OUTSIDE. returns the cut weight */
+enum { OUTSIDE = 1, INSIDE = 2 };
+
+static I64 grow(HostGraph const& g, std::vector<LO> const& verts, LO seed,
+    Real target, std::vector<I8>& state, std::vector<I64>& gains) {
+  for (auto v : verts) state[v] = OUTSIDE;
+  /* the change in cut if a vertex joined the region */
+  I64 cut = 0;
+  for (auto v : verts) {
+    gains[v] = 0;
+    for (auto vu = g.offsets[v]; vu < g.offsets[v + 1]; ++vu) {
+      if (state[g.adj[vu]]) gains[v] -= g.adj_weights[vu];
+    }
+  }
+  std::priority_queue<std::pair<I64, LO>> frontier;
+  frontier.push(std::make_pair(gains[seed], seed));
+  I64 weight = 0;
+  std::size_t next_seed = 0;
+  while (true) {
+    LO v = -1;
+    while (!frontier.empty()) {
+      auto top = frontier.top();
+      frontier.pop();
+      /* skip entries made stale by later gain updates */
+      if (state[top.second] == OUTSIDE && top.first == gains[top.second]) {
+        v = top.second;
+        break;
+      }
+    }
+    if (v == -1) {
+      while (next_seed < verts.size() && state[verts[next_seed]] != OUTSIDE) {
+        ++next_seed;
+      }
+      if (next_seed == verts.size()) break;
+      v = verts[next_seed];
+    }
+    if (Real(weight) + Real(g.weights[v]) / 2 >= target) break;
+    state[v] = INSIDE;
+    weight += g.weights[v];
+    cut -= gains[v];
+    for (auto vu = g.offsets[v]; vu < g.offsets[v + 1]; ++vu) {
+      auto u = g.adj[vu];
+      if (state[u] != OUTSIDE) continue;
+      gains[u] += 2 * g.adj_weights[vu];
+      frontier.push(std::make_pair(gains[u], u));
+    }
+  }
+  return cut;
+}
+
+/* recursive bisection. one half is grown from each of a few
+   mutually distant vertices, and the growth with the smallest
+   cut is kept */
+static void bisect(HostGraph const& g, std::vector<LO> const& verts,
+    I32 first_part, I32 nparts, std::vector<I32>& parts,
+    std::vector<I8>& state, std::vector<I64>& gains) {
+  if (verts.empty()) return;
+  if (nparts == 1) {
+    for (auto v : verts) parts[v] = first_part;
+    return;
+  }
+  auto nleft = nparts / 2;
+  I64 total = 0;
+  for (auto v : verts) total += g.weights[v];
+  auto target = Real(total) * Real(nleft) / Real(nparts);
+  LO best_seed = -1;
+  I64 best_cut = 0;
+  auto seed = verts.front();
+  for (Int trial = 0; trial < 4; ++trial) {
+    seed = bfs_order(g, verts, seed, state).back();
+    auto cut = grow(g, verts, seed, target, state, gains);
+    if (best_seed == -1 || cut < best_cut) {
+      best_seed = seed;
+      best_cut = cut;
+    }
+    for (auto v : verts) state[v] = 0;
+  }
+  grow(g, verts, best_seed, target, state, gains);
+  std::vector<LO> left;
+  std::vector<LO> right;
+  for (auto v : verts) {
+    if (state[v] == INSIDE) left.push_back(v);
+    else right.push_back(v);
+    state[v] = 0;
+  }
+  bisect(g, left, first_part, nleft, parts, state, gains);
+  bisect(g, right, first_part + nleft, nparts - nleft, parts, state, gains);
+}
+
+/* the best part to move a vertex to, or its own part.
+   (conn) is the edge weight to each part in (nbr_parts).
+   a move must reduce the cut, unless the vertex is leaving
+   an overloaded part, in which case the cut may also grow */
+template <typename CanMove>
+static I32 choose_part(I32 own, std::vector<I32> const& nbr_parts,
+    std::vector<I64> const& conn, bool leaving_overload, CanMove can_move) {
+  auto best = own;
+  I64 best_gain = 0;
+  for (auto q : nbr_parts) {
+    if (q == own || !can_move(q)) continue;
+    auto gain = conn[q] - conn[own];
+    auto acceptable = (gain > 0) || leaving_overload;
+    if (!acceptable) continue;
+    if (best == own || gain > best_gain) {
+      best = q;
+      best_gain = gain;
+    }
+  }
+  return best;
+}
+
+/* gathers the parts of the neighbors of one vertex and the
+   edge weight to each, resetting after each vertex */
+struct Connectivity {
+  std::vector<I64> conn;
+  std::vector<I32> parts;
+  Connectivity(I32 nparts) : conn(std::size_t(nparts), 0) {}
+  void add(I32 part, I64 weight) {
+    if (part < 0) return;
+    if (!conn[part]) parts.push_back(part);
+    conn[part] += weight;
+  }
+  void clear() {
+    for (auto q : parts) conn[q] = 0;
+    parts.clear();
+  }
+};
+
+static void refine_serial(HostGraph const& g, I32 nparts, I64 max_part_weight,
+    std::vector<I32>& parts) {
+  std::vector<I64> part_weights(std::size_t(nparts), 0);
+  for (LO v = 0; v < g.nverts(); ++v) part_weights[parts[v]] += g.weights[v];
+  Connectivity c(nparts);
+  for (Int pass = 0; pass < 8; ++pass) {
+    LO nmoved = 0;
+    for (LO v = 0; v < g.nverts(); ++v) {
+      auto own = parts[v];
+      auto w = g.weights[v];
+      for (auto vu = g.offsets[v]; vu < g.offsets[v + 1]; ++vu) {
+        c.add(parts[g.adj[vu]], g.adj_weights[vu]);
+      }
+      auto leaving_overload = part_weights[own] > max_part_weight;
+      auto can_move = [&](I32 q) {
+        return part_weights[q] + w <= max_part_weight;
+      };
+      auto q = choose_part(own, c.parts, c.conn, leaving_overload, can_move);
+      c.clear();
+      if (q == own) continue;
+      parts[v] = q;
+      part_weights[own] -= w;
+      part_weights[q] += w;
+      ++nmoved;
+    }
+    if (!nmoved) break;
+  }
+}
+
+static std::vector<I32> partition_serial(
+    HostGraph const& g, I32 nparts, I64 max_part_weight) {
+  auto n = g.nverts();
+  std::vector<I32> parts(std::size_t(n), 0);
+  std::vector<I8> state(std::size_t(n), 0);
+  std::vector<I64> gains(std::size_t(n), 0);
+  std::vector<LO> verts(static_cast<std::size_t>(n));
+  std::iota(verts.begin(), verts.end(), 0);
+  bisect(g, verts, 0, nparts, parts, state, gains);
+  refine_serial(g, nparts, max_part_weight, parts);
+  return parts;
+}
+
+/* an edge from vertex (from) of a rank's graph to a vertex held
+   by another rank. both ends are also named by the global ids of
+   the coarsest per-rank vertices they started out in, and the
+   rank holding the other end holds the reverse edge */
+struct ExtEdge {
+  I64 from_id;
+  LO from;
+  I64 to_id;
+  I64 weight;
+};
+
+/* what a rank that received a graph while folding needs in order
+   to send the parts of those vertices back */
+struct Fold {
+  LO nown;
+  std::vector<LO> joined2coarse;
+};
+
+template <typename T>
+static std::vector<T> send_to(
+    CommPtr comm, std::vector<T> const& data, Int width, I32 dest) {
+  HostWrite<T> h_data(LO(data.size()));
+  for (LO i = 0; i < h_data.size(); ++i) h_data[i] = data[std::size_t(i)];
+  Dist dist;
+  dist.set_parent_comm(comm);
+  dist.set_dest_ranks(Read<I32>(h_data.size() / width, dest));
+  auto recvd = HostRead<T>(dist.exch(Read<T>(h_data.write()), width));
+  return std::vector<T>(recvd.data(), recvd.data() + recvd.size());
+}
+
+/* builds a graph from (from, to, weight) triples, merging
+   repeated edges into one */
+static HostGraph graph_from_edges(
+    std::vector<I64> const& weights, std::vector<I64> const& edges) {
+  auto n = LO(weights.size());
+  auto nedges = LO(edges.size() / 3);
+  HostGraph g;
+  g.weights = weights;
+  g.offsets.assign(std::size_t(n + 1), 0);
+  for (LO i = 0; i < nedges; ++i) ++g.offsets[edges[i * 3] + 1];
+  std::partial_sum(g.offsets.begin(), g.offsets.end(), g.offsets.begin());
+  g.adj.resize(std::size_t(nedges));
+  g.adj_weights.resize(std::size_t(nedges));
+  auto fill = g.offsets;
+  for (LO i = 0; i < nedges; ++i) {
+    auto pos = fill[edges[i * 3 + 0]]++;
+    g.adj[pos] = LO(edges[i * 3 + 1]);
+    g.adj_weights[pos] = edges[i * 3 + 2];
+  }
+  std::vector<LO> identity(static_cast<std::size_t>(n));
+  std::iota(identity.begin(), identity.end(), 0);
+  return contract(g, identity, n);
+}
+
+/* one step of folding: each rank that is an odd multiple of
+   (stride) sends its graph to the rank (stride) below it, which
+   joins the two graphs, turns the edges between them into local
+   edges, and coarsens the result by heavy-edge matching */
+static Fold fold(CommPtr comm, I32 stride, HostGraph& g,
+    std::vector<ExtEdge>& ext, I64 max_vertex_weight) {
+  auto rank = comm->rank();
+  auto sends = (rank % (2 * stride) == stride);
+  auto receives =
+      (rank % (2 * stride) == 0) && (rank + stride < comm->size());
+  std::vector<I64> verts;
+  std::vector<I64> adj;
+  std::vector<I64> exts;
+  if (sends) {
+    for (LO v = 0; v < g.nverts(); ++v) {
+      verts.push_back(g.weights[v]);
+      verts.push_back(g.offsets[v + 1] - g.offsets[v]);
+    }
+    for (std::size_t vu = 0; vu < g.adj.size(); ++vu) {
+      adj.push_back(g.adj[vu]);
+      adj.push_back(g.adj_weights[vu]);
+    }
+    for (auto& e : ext) {
+      exts.insert(exts.end(), {e.from_id, e.from, e.to_id, e.weight});
+    }
+    g = HostGraph();
+    ext.clear();
+  }
+  auto dest = sends ? rank - stride : rank;
+  verts = send_to(comm, verts, 2, dest);
+  adj = send_to(comm, adj, 2, dest);
+  exts = send_to(comm, exts, 4, dest);
+  Fold out;
+  out.nown = g.nverts();
+  if (!receives) return out;
+  auto nsent = LO(verts.size() / 2);
+  std::vector<I64> weights = g.weights;
+  std::vector<I64> edges;
+  for (LO v = 0; v < out.nown; ++v) {
+    for (auto vu = g.offsets[v]; vu < g.offsets[v + 1]; ++vu) {
+      edges.insert(edges.end(), {v, g.adj[vu], g.adj_weights[vu]});
+    }
+  }
+  std::size_t vu = 0;
+  for (LO v = 0; v < nsent; ++v) {
+    weights.push_back(verts[std::size_t(v * 2 + 0)]);
+    for (I64 i = 0; i < verts[std::size_t(v * 2 + 1)]; ++i, ++vu) {
+      edges.insert(edges.end(),
+          {out.nown + v, out.nown + adj[vu * 2 + 0], adj[vu * 2 + 1]});
+    }
+  }
+  for (std::size_t i = 0; i < exts.size() / 4; ++i) {
+    ext.push_back({exts[i * 4 + 0], out.nown + LO(exts[i * 4 + 1]),
+        exts[i * 4 + 2], exts[i * 4 + 3]});
+  }
+  std::map<I64, LO> ids2joined;
+  for (auto& e : ext) ids2joined[e.from_id] = e.from;
+  std::vector<ExtEdge> still_ext;
+  for (auto& e : ext) {
+    auto it = ids2joined.find(e.to_id);
+    if (it == ids2joined.end()) {
+      still_ext.push_back(e);
+    } else {
+      edges.insert(edges.end(), {e.from, it->second, e.weight});
+    }
+  }
+  ext.swap(still_ext);
+  g = graph_from_edges(weights, edges);
+  out.joined2coarse.resize(weights.size());
+  std::iota(out.joined2coarse.begin(), out.joined2coarse.end(), 0);
+  while (true) {
+    std::vector<LO> fine2coarse;
+    auto nc = match_heavy_edges(g, max_vertex_weight, fine2coarse);
+    if (nc == g.nverts() || 10 * nc > 9 * g.nverts()) break;
+    g = contract(g, fine2coarse, nc);
+    for (auto& v : out.joined2coarse) v = fine2coarse[v];
+    for (auto& e : ext) e.from = fine2coarse[e.from];
+  }
+  return out;
+}
+
+/* undoes one step of folding: a rank that received a graph
+   at this (stride) sends the parts of its vertices back */
+static void unfold(CommPtr comm, I32 stride, Fold const& fold,
+    std::vector<I32>& parts) {
+  auto rank = comm->rank();
+  std::vector<I32> sent_parts;
+  if (!fold.joined2coarse.empty()) {
+    std::vector<I32> joined_parts;
+    for (auto v : fold.joined2coarse) joined_parts.push_back(parts[v]);
+    parts.assign(joined_parts.begin(), joined_parts.begin() + fold.nown);
+    sent_parts.assign(joined_parts.begin() + fold.nown, joined_parts.end());
+  }
+  auto recvd = send_to(comm, sent_parts, 1, rank + stride);
+  if (rank % (2 * stride) == stride) parts = recvd;
+}
+
+/* partitions the union of the coarsest per-rank graphs.
+   they are folded onto rank 0 along a binary tree, coarsening
+   across the former rank boundaries at every join, so rank 0
+   only receives graphs that are already coarse and partitions
+   the last one serially. (ext) holds the edges of (g) that
+   lead to other ranks. returns the part of each vertex of (g) */
+static std::vector<I32> partition_by_folding(CommPtr comm, HostGraph g,
+    std::vector<ExtEdge> ext, I64 max_vertex_weight, I64 max_part_weight) {
+  auto nparts = comm->size();
+  std::vector<Fold> folds;
+  for (I32 stride = 1; stride < nparts; stride *= 2) {
+    folds.push_back(fold(comm, stride, g, ext, max_vertex_weight));
+  }
+  std::vector<I32> parts;
+  if (comm->rank() == 0) {
+    CHECK(ext.empty());
+    parts = partition_serial(g, nparts, max_part_weight);
+  }
+  auto stride = I32(1) << folds.size();
+  while (!folds.empty()) {
+    stride /= 2;
+    unfold(comm, stride, folds.back(), parts);
+    folds.pop_back();
+  }
+  return parts;
+}
+
+/* parallel greedy refinement of one level of the hierarchy.
+   (elem2vert) maps elements to vertices of (g), and (is_remote)
+   marks element sides whose neighbor is on another rank; edges
+   to those neighbors only exist through the mesh.
+   to keep neighbors on different ranks from swapping places,
+   even passes only move vertices to higher parts and odd
+   passes only to lower parts. each rank may fill only its share
+   of the room left in a part, so parts cannot be overfilled */
+static void refine_level(Mesh* mesh, HostGraph const& g,
+    std::vector<LO> const& elem2vert, std::vector<I8> const& is_remote,
+    I64 max_part_weight, std::vector<I32>& parts) {
+  auto comm = mesh->comm();
+  auto nparts = comm->size();
+  auto nelems = mesh->nelems();
+  auto nsides_per_elem = simplex_degrees[mesh->dim()][mesh->dim() - 1];
+  auto n = g.nverts();
+  Connectivity c(nparts);
+  std::vector<LO> ext_offsets(static_cast<std::size_t>(n + 1));
+  std::vector<I32> ext_parts;
+  LO nmoved = 0;
+  for (Int pass = 0; pass < 8; ++pass) {
+    std::vector<I64> part_weights(std::size_t(nparts + 1), 0);
+    for (LO v = 0; v < n; ++v) part_weights[parts[v]] += g.weights[v];
+    part_weights.back() = nmoved;
+    part_weights = comm->allreduce(part_weights,
+        std::vector<Omega_h_Op>(part_weights.size(), OMEGA_H_SUM));
+    if (pass && !part_weights.back()) break;
+    HostWrite<I64> h_parts(nelems);
+    for (LO e = 0; e < nelems; ++e) h_parts[e] = parts[elem2vert[e]];
+    auto nbr_parts =
+        HostRead<I64>(values_across_sides(mesh, h_parts.write()));
+    std::fill(ext_offsets.begin(), ext_offsets.end(), 0);
+    for (LO es = 0; es < nelems * nsides_per_elem; ++es) {
+      if (is_remote[es]) ++ext_offsets[elem2vert[es / nsides_per_elem] + 1];
+    }
+    std::partial_sum(ext_offsets.begin(), ext_offsets.end(),
+        ext_offsets.begin());
+    ext_parts.resize(std::size_t(ext_offsets.back()));
+    auto fill = ext_offsets;
+    for (LO es = 0; es < nelems * nsides_per_elem; ++es) {
+      if (!is_remote[es]) continue;
+      ext_parts[fill[elem2vert[es / nsides_per_elem]]++] = I32(nbr_parts[es]);
+    }
+    std::vector<I64> room(static_cast<std::size_t>(nparts));
+    std::vector<I64> excess(static_cast<std::size_t>(nparts));
+    for (I32 p = 0; p < nparts; ++p) {
+      room[p] = max2(max_part_weight - part_weights[p], I64(0)) / nparts;
+      excess[p] = max2(part_weights[p] - max_part_weight, I64(0)) / nparts;
+    }
+    auto upward = (pass % 2 == 0);
+    nmoved = 0;
+    for (LO v = 0; v < n; ++v) {
+      auto own = parts[v];
+      auto w = g.weights[v];
+      for (auto vu = g.offsets[v]; vu < g.offsets[v + 1]; ++vu) {
+        c.add(parts[g.adj[vu]], g.adj_weights[vu]);
+      }
+      for (auto ve = ext_offsets[v]; ve < ext_offsets[v + 1]; ++ve) {
+        c.add(ext_parts[ve], 1);
+      }
+      auto can_move = [&](I32 q) {
+        return ((q > own) == upward) && (room[q] >= w);
+      };
+      auto leaving_overload = (excess[own] >= w);
+      auto q = choose_part(own, c.parts, c.conn, leaving_overload, can_move);
+      if (q != own) {
+        if (c.conn[q] <= c.conn[own]) excess[own] -= w;
+        room[q] -= w;
+        parts[v] = q;
+        ++nmoved;
+      }
+      c.clear();
+    }
+  }
+}
+
+Remotes partition(Mesh* mesh, Reals masses, Real tolerance) {
+  auto comm = mesh->comm();
+  auto nparts = comm->size();
+  auto nelems = mesh->nelems();
+  auto owners = mesh->ask_owners(mesh->dim());
+  if (nparts == 1) return owners;
+  CHECK(mesh->parting() == OMEGA_H_ELEM_BASED);
+  auto nsides_per_elem = simplex_degrees[mesh->dim()][mesh->dim() - 1];
+  auto weights = quantize_masses(masses, max(comm, masses));
+  auto total = comm->allreduce(sum(weights), OMEGA_H_SUM);
+  auto avg = Real(total) / Real(nparts);
+  auto max_part_weight = I64(avg * (1.0 + max2(tolerance, 0.03)));
+  auto first_id = comm->exscan(I64(nelems), OMEGA_H_SUM);
+  auto nbr_ids = values_across_sides(mesh, Read<I64>(nelems, first_id, 1));
+  std::vector<HostGraph> levels;
+  levels.push_back(local_dual(weights, nbr_ids, first_id, nsides_per_elem));
+  /* the vertex of each level that each element belongs to */
+  std::vector<std::vector<LO>> elem2verts(1);
+  elem2verts[0].resize(std::size_t(nelems));
+  std::iota(elem2verts[0].begin(), elem2verts[0].end(), 0);
+  /* coarsen until parts would be made of a few dozen coarse
+     vertices, or until matching stalls on all ranks.
+     ranks where it stalled early repeat their coarsest graph,
+     so that all ranks refine the same number of levels */
+  auto max_vertex_weight = max2(I64(avg / 32.0), I64(1));
+  while (true) {
+    auto const& fine = levels.back();
+    std::vector<LO> fine2coarse;
+    auto nc = match_heavy_edges(fine, max_vertex_weight, fine2coarse);
+    auto stalled = (nc == fine.nverts() || 10 * nc > 9 * fine.nverts());
+    if (comm->allreduce(I32(!stalled), OMEGA_H_MAX) == 0) break;
+    if (stalled) {
+      nc = fine.nverts();
+      std::iota(fine2coarse.begin(), fine2coarse.end(), 0);
+    }
+    levels.push_back(contract(fine, fine2coarse, nc));
+    auto elem2vert = elem2verts.back();
+    for (auto& v : elem2vert) v = fine2coarse[v];
+    elem2verts.push_back(elem2vert);
+  }
+  auto const& elem2coarse = elem2verts.back();
+  auto nc = levels.back().nverts();
+  auto first_coarse = comm->exscan(I64(nc), OMEGA_H_SUM);
+  HostWrite<I64> h_elem_coarse(nelems);
+  for (LO e = 0; e < nelems; ++e) {
+    h_elem_coarse[e] = first_coarse + elem2coarse[e];
+  }
+  auto nbr_coarse = HostRead<I64>(
+      values_across_sides(mesh, h_elem_coarse.write()));
+  std::map<std::pair<I64, I64>, I64> coarse_ext;
+  for (LO e = 0; e < nelems; ++e) {
+    auto cv = h_elem_coarse[e];
+    for (Int es = 0; es < nsides_per_elem; ++es) {
+      auto cu = nbr_coarse[e * nsides_per_elem + es];
+      if (cu >= 0 && !(first_coarse <= cu && cu < first_coarse + nc)) {
+        ++coarse_ext[std::make_pair(cv, cu)];
+      }
+    }
+  }
+  std::vector<ExtEdge> ext;
+  for (auto& edge : coarse_ext) {
+    ext.push_back({edge.first.first, LO(edge.first.first - first_coarse),
+        edge.first.second, edge.second});
+  }
+  auto parts = partition_by_folding(
+      comm, levels.back(), ext, max_vertex_weight, max_part_weight);
+  HostRead<I64> h_nbr_ids(nbr_ids);
+  std::vector<I8> is_remote(static_cast<std::size_t>(h_nbr_ids.size()));
+  for (LO es = 0; es < h_nbr_ids.size(); ++es) {
+    auto nbr = h_nbr_ids[es];
+    is_remote[es] = (nbr >= 0) && !(first_id <= nbr && nbr < first_id + nelems);
+  }
+  for (auto level = levels.size(); level-- > 0;) {
+    refine_level(mesh, levels[level], elem2verts[level], is_remote,
+        max_part_weight, parts);
+    if (level == 0) break;
+    /* project onto the next finer level */
+    std::vector<I32> finer(std::size_t(levels[level - 1].nverts()));
+    for (LO e = 0; e < nelems; ++e) {
+      finer[elem2verts[level - 1][e]] = parts[elem2verts[level][e]];
+    }
+    parts.swap(finer);
+  }
+  HostWrite<I32> h_parts(nelems);
+  for (LO e = 0; e < nelems; ++e) h_parts[e] = parts[e];
+  Dist dist;
+  dist.set_parent_comm(comm);
+  dist.set_dest_ranks(h_parts.write());
+  return dist.exch(owners, 1);
+}
+
+}  // end namespace multilevel
+
+}  // end namespace Omega_h
@@ -0,0 +1,29 @@
+#ifndef MULTILEVEL_HPP
+#define MULTILEVEL_HPP
+
+#include "internal.hpp"
+
+namespace Omega_h {
+
+namespace multilevel {
+
+/* partition the elements of an element-based mesh among the
+   ranks of its communicator so as to minimize the number of
+   sides between parts, while keeping the total mass of each part
+   within (1 + tolerance) of the average.
+   the element dual graph is coarsened on each rank by heavy-edge
+   matching until coarse vertices weigh about 1/32 of a part.
+   the coarsest graphs are then folded onto rank 0 along a binary
+   tree: at each join the receiving rank matches across the
+   boundary it now holds both sides of, so the graph that reaches
+   rank 0 has a few dozen vertices per part however the mesh was
+   spread out, and that is what rank 0 partitions serially.
+   the projected partition is improved by greedy boundary moves.
+   returns, for each element a rank receives, its current owner */
+Remotes partition(Mesh* mesh, Reals masses, Real tolerance);
+
+}  // end namespace multilevel
+
+}  // end namespace Omega_h
+
+#endif
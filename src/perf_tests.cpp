@@ -10,6 +10,7 @@
 #include "internal.hpp"
 #include "loop.hpp"
 #include "metric.hpp"
+#include "refine.hpp"
 #include "sort.hpp"
 #include "space.hpp"
 #include "timer.hpp"
@@ -234,6 +235,30 @@ static void test_adjs(Library const& lib) {
   test_reflect_down(tets2verts, tris2verts, nverts);
 }
 
+/* refinement that only touches a small corner of a large mesh,
+   which is where the cost of unchanged entities shows */
+static void test_refine_corner(Library const& lib) {
+  Mesh mesh;
+  auto nx = 24;
+  build_box(&mesh, lib, 1, 1, 1, nx, nx, nx);
+  auto coords = mesh.coords();
+  Write<Real> size(mesh.nverts());
+  auto h = 1.0 / nx;
+  auto f = LAMBDA(LO v) {
+    auto x = get_vector<3>(coords, v);
+    size[v] = (x[0] + x[1] + x[2] < 6.0 * h) ? (h / 2.0) : (4.0 * h);
+  };
+  parallel_for(mesh.nverts(), f);
+  mesh.add_tag(VERT, "size", 1, OMEGA_H_LINEAR_INTERP, OMEGA_H_DO_OUTPUT,
+      Reals(size));
+  auto nelems = mesh.nelems();
+  Now t0 = now();
+  refine_by_size(&mesh, 1.5, 0.0, false);
+  Now t1 = now();
+  std::cout << "refining " << (mesh.nelems() - nelems) << " new tets into a "
+            << nelems << " tet mesh took " << (t1 - t0) << " seconds\n";
+}
+
 int main(int argc, char** argv) {
   auto lib = Library(&argc, &argv);
 #ifndef __INTEL_COMPILER
@@ -242,4 +267,5 @@ int main(int argc, char** argv) {
   test_sort();
 #endif
   test_adjs(lib);
+  test_refine_corner(lib);
 }
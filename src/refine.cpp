@@ -2,9 +2,11 @@
 
 #include <iostream>
 
+#include "adapt_stats.hpp"
 #include "array.hpp"
 #include "indset.hpp"
 #include "map.hpp"
+#include "mark.hpp"
 #include "modify.hpp"
 #include "refine_qualities.hpp"
 #include "refine_topology.hpp"
@@ -45,10 +47,14 @@ static void refine_element_based(Mesh* mesh, bool verbose) {
   if (verbose && comm->rank() == 0) {
     std::cout << "refining " << ntotal_keys << " edges\n";
   }
+  record_adapt_keys(mesh, EDGE, keys2edges);
+  AdaptTimer timer(ADAPT_MODIFICATION);
+  release_for_modify(mesh);
   auto new_mesh = mesh->copy_meta();
   auto keys2midverts = LOs();
   auto old_verts2new_verts = LOs();
   auto old_lows2new_lows = LOs();
+  auto low_prods2new_lows = LOs();
   for (Int ent_dim = 0; ent_dim <= mesh->dim(); ++ent_dim) {
     auto keys2prods = LOs();
     auto prod_verts2verts = LOs();
@@ -63,8 +69,9 @@ static void refine_element_based(Mesh* mesh, bool verbose) {
     auto same_ents2new_ents = LOs();
     auto old_ents2new_ents = LOs();
     modify_ents(mesh, &new_mesh, ent_dim, EDGE, keys2edges, keys2prods,
-        prod_verts2verts, old_lows2new_lows, &prods2new_ents,
-        &same_ents2old_ents, &same_ents2new_ents, &old_ents2new_ents);
+        prod_verts2verts, old_lows2new_lows, low_prods2new_lows,
+        &prods2new_ents, &same_ents2old_ents, &same_ents2new_ents,
+        &old_ents2new_ents);
     if (ent_dim == VERT) {
       keys2midverts = prods2new_ents;
       old_verts2new_verts = old_ents2new_ents;
@@ -72,22 +79,29 @@ static void refine_element_based(Mesh* mesh, bool verbose) {
     transfer_refine(mesh, &new_mesh, keys2edges, keys2midverts, ent_dim,
         keys2prods, prods2new_ents, same_ents2old_ents, same_ents2new_ents);
     old_lows2new_lows = old_ents2new_ents;
+    low_prods2new_lows = prods2new_ents;
+    release_modified_dim(mesh, ent_dim, EDGE);
   }
   *mesh = new_mesh;
 }
 
 bool refine(Mesh* mesh, Real min_qual, bool verbose) {
-  mesh->set_parting(OMEGA_H_GHOSTED);
+  /* only the cavities around candidate edges need their ghosts */
+  auto edges_are_cands = mesh->get_array<I8>(EDGE, "candidate");
+  record_adapt_cands(mesh, EDGE, edges_are_cands);
+  mesh->ghost_partially(mark_down(mesh, EDGE, VERT, edges_are_cands));
   if (!refine_ghosted(mesh, min_qual)) return false;
   mesh->set_parting(OMEGA_H_ELEM_BASED);
   refine_element_based(mesh, verbose);
   return true;
 }
 
-bool refine_by_size(Mesh* mesh, Real max_len, Real min_qual, bool verbose) {
+bool refine_by_size(Mesh* mesh, Real max_len, Real min_qual, bool verbose,
+    Read<I8> elems_are_in) {
   auto comm = mesh->comm();
   auto lengths = mesh->ask_lengths();
   auto edge_is_cand = each_gt(lengths, max_len);
+  edge_is_cand = restrict_to_region(mesh, EDGE, edge_is_cand, elems_are_in);
   if (comm->allreduce(max(edge_is_cand), OMEGA_H_MAX) != 1) return false;
   mesh->add_tag(EDGE, "candidate", 1, OMEGA_H_DONT_TRANSFER,
       OMEGA_H_DONT_OUTPUT, edge_is_cand);
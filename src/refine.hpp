@@ -6,7 +6,10 @@
 namespace Omega_h {
 
 bool refine(Mesh* mesh, Real min_qual, bool verbose);
-bool refine_by_size(Mesh* mesh, Real max_len, Real min_qual, bool verbose);
+/* only edges of the elements marked by (elems_are_in),
+   if it exists, are candidates */
+bool refine_by_size(Mesh* mesh, Real max_len, Real min_qual, bool verbose,
+    Read<I8> elems_are_in = Read<I8>());
 
 }  // end namespace Omega_h
 
@@ -7,6 +7,7 @@
 #include "quality.hpp"
 #include "refine_topology.hpp"
 #include "simplices.hpp"
+#include "transfer.hpp"
 
 namespace Omega_h {
 
@@ -23,8 +24,8 @@ struct MetricRefineQualities {
   Reals midpt_metrics;
   MetricRefineQualities(Mesh* mesh, LOs candidates)
       : vert_metrics(mesh->get_array<Real>(VERT, "metric")),
-        midpt_metrics(average_metric(
-            mesh, EDGE, candidates, mesh->get_array<Real>(VERT, "metric"))) {}
+        midpt_metrics(midpoint_values(
+            mesh, candidates, mesh->get_tagbase(VERT, "metric"))) {}
   template <Int dim>
   DEVICE Real measure(
       Int cand, Few<Vector<dim>, dim + 1> p, Few<LO, dim> csv2v) const {
@@ -0,0 +1,885 @@
+#include "refine_templates.hpp"
+
+#include <iostream>
+
+#include "access.hpp"
+#include "adapt_stats.hpp"
+#include "adjacency.hpp"
+#include "array.hpp"
+#include "construct.hpp"
+#include "linpart.hpp"
+#include "loop.hpp"
+#include "map.hpp"
+#include "mark.hpp"
+#include "metric.hpp"
+#include "owners.hpp"
+#include "quality.hpp"
+#include "scan.hpp"
+#include "simplices.hpp"
+#include "size.hpp"
+#include "tag.hpp"
+#include "transfer.hpp"
+
+namespace Omega_h {
+
+namespace refine_templates {
+
+enum { MAX_CHILDREN = 8 };
+
+DEVICE Int tet_edge_between(Int a, Int b) {
+  for (Int e = 0; e < 6; ++e) {
+    auto ea = DownTemplate<3, 1>::get(e, 0);
+    auto eb = DownTemplate<3, 1>::get(e, 1);
+    if ((ea == a && eb == b) || (ea == b && eb == a)) return e;
+  }
+  return -1;
+}
+
+DEVICE Int tet_face_edge_mask(Int f) {
+  Int mask = 0;
+  for (Int k = 0; k < 3; ++k) {
+    auto a = DownTemplate<3, 2>::get(f, k);
+    auto b = DownTemplate<3, 2>::get(f, (k + 1) % 3);
+    mask |= (1 << tet_edge_between(a, b));
+  }
+  return mask;
+}
+
+/* the first face of a tet containing all the marked edges in (mask),
+   or -1 if there is none */
+DEVICE Int tet_template_face(Int mask) {
+  for (Int f = 0; f < 4; ++f) {
+    if (!(mask & ~tet_face_edge_mask(f))) return f;
+  }
+  return -1;
+}
+
+DEVICE bool tet_has_template(Int mask) {
+  return mask == 0 || mask == 63 || tet_template_face(mask) >= 0;
+}
+
+DEVICE void set_child(LO child[], LO a, LO b, LO c) {
+  child[0] = a;
+  child[1] = b;
+  child[2] = c;
+}
+
+DEVICE void set_child(LO child[], LO a, LO b, LO c, LO d) {
+  set_child(child, a, b, c);
+  child[3] = d;
+}
+
+/* splits the triangle (fv) whose edge k goes from fv[k] to fv[k + 1]
+   and has midpoint vertex fm[k], or -1 if it is not marked.
+   a quadrilateral left by two marked edges is cut along the diagonal
+   from the unmarked edge's vertex with the larger global number,
+   so that both elements sharing a face cut it the same way */
+DEVICE Int split_face(LO const fv[], LO const fm[], GO const fg[],
+    LO children[][4]) {
+  Int nmarked = 0;
+  Int unmarked = 0;
+  for (Int k = 0; k < 3; ++k) {
+    if (fm[k] >= 0) {
+      ++nmarked;
+    } else {
+      unmarked = k;
+    }
+  }
+  if (nmarked == 0) {
+    set_child(children[0], fv[0], fv[1], fv[2]);
+    return 1;
+  }
+  if (nmarked == 3) {
+    set_child(children[0], fv[0], fm[0], fm[2]);
+    set_child(children[1], fm[0], fv[1], fm[1]);
+    set_child(children[2], fm[2], fm[1], fv[2]);
+    set_child(children[3], fm[0], fm[1], fm[2]);
+    return 4;
+  }
+  if (nmarked == 1) {
+    Int k = 0;
+    while (fm[k] < 0) ++k;
+    auto u = fv[k];
+    auto w = fv[(k + 1) % 3];
+    auto x = fv[(k + 2) % 3];
+    set_child(children[0], u, fm[k], x);
+    set_child(children[1], fm[k], w, x);
+    return 2;
+  }
+  auto k = unmarked;
+  auto u = fv[k];
+  auto w = fv[(k + 1) % 3];
+  auto x = fv[(k + 2) % 3];
+  auto a = fm[(k + 1) % 3];
+  auto b = fm[(k + 2) % 3];
+  set_child(children[0], b, a, x);
+  if (fg[k] > fg[(k + 1) % 3]) {
+    set_child(children[1], u, w, a);
+    set_child(children[2], u, a, b);
+  } else {
+    set_child(children[1], u, w, b);
+    set_child(children[2], w, a, b);
+  }
+  return 3;
+}
+
+/* the inner octahedron of a 1:8 split is cut along its shortest
+   diagonal, which joins the midpoints of tet edges d and opposite(d) */
+DEVICE Int octahedron_diagonal(LO const em[], Reals const& coords) {
+  Int d = 0;
+  Real best_len = 0.0;
+  for (Int e = 0; e < 3; ++e) {
+    auto a = get_vector<3>(coords, em[e]);
+    auto b = get_vector<3>(coords, em[OppositeTemplate<3, 1>::get(e)]);
+    auto len = norm(b - a);
+    if (e == 0 || len < best_len) {
+      d = e;
+      best_len = len;
+    }
+  }
+  return d;
+}
+
+/* the other four tet edges, ordered so that consecutive midpoints
+   are octahedron neighbors */
+DEVICE void octahedron_ring(Int d, Int ring[]) {
+  Int nring = 0;
+  for (Int e = 0; e < 3; ++e) {
+    if (e == d) continue;
+    ring[nring] = e;
+    ring[nring + 2] = OppositeTemplate<3, 1>::get(e);
+    ++nring;
+  }
+}
+
+/* 1:8 split: four corner tets and four around the octahedron diagonal */
+DEVICE Int split_tet_all(
+    LO const ev[], LO const em[], Reals const& coords, LO children[][4]) {
+  for (Int i = 0; i < 4; ++i) {
+    for (Int j = 0; j < 4; ++j) {
+      children[i][j] = (i == j) ? ev[i] : em[tet_edge_between(i, j)];
+    }
+  }
+  auto d = octahedron_diagonal(em, coords);
+  auto od = OppositeTemplate<3, 1>::get(d);
+  Int ring[4];
+  octahedron_ring(d, ring);
+  for (Int k = 0; k < 4; ++k) {
+    set_child(children[4 + k], em[d], em[od], em[ring[k]],
+        em[ring[(k + 1) % 4]]);
+  }
+  return 8;
+}
+
+DEVICE Int split_tet(LO const ev[], LO const em[], GO const eg[],
+    Reals const& coords, LO children[][4]) {
+  Int mask = 0;
+  for (Int e = 0; e < 6; ++e) {
+    if (em[e] >= 0) mask |= (1 << e);
+  }
+  if (mask == 63) return split_tet_all(ev, em, coords, children);
+  auto f = tet_template_face(mask);
+  if (f < 0) f = 0;
+  LO fv[3];
+  LO fm[3];
+  GO fg[3];
+  for (Int k = 0; k < 3; ++k) {
+    auto a = DownTemplate<3, 2>::get(f, k);
+    auto b = DownTemplate<3, 2>::get(f, (k + 1) % 3);
+    fv[k] = ev[a];
+    fm[k] = em[tet_edge_between(a, b)];
+    fg[k] = eg[a];
+  }
+  auto n = split_face(fv, fm, fg, children);
+  auto apex = ev[OppositeTemplate<3, 2>::get(f)];
+  for (Int i = 0; i < n; ++i) children[i][3] = apex;
+  return n;
+}
+
+template <Int dim>
+DEVICE void orient_child(LO child[], Reals const& coords) {
+  Few<LO, dim + 1> v;
+  for (Int j = 0; j < dim + 1; ++j) v[j] = child[j];
+  auto p = gather_vectors<dim + 1, dim>(coords, v);
+  if (real_element_size<dim>(p) < 0.0) swap2(child[1], child[2]);
+}
+
+template <Int dim>
+struct SimplexSplitter;
+
+template <>
+struct SimplexSplitter<2> {
+  DEVICE static Int split(LO const ev[], LO const em[], GO const eg[],
+      Reals const&, LO children[][4]) {
+    return split_face(ev, em, eg, children);
+  }
+};
+
+template <>
+struct SimplexSplitter<3> {
+  DEVICE static Int split(LO const ev[], LO const em[], GO const eg[],
+      Reals const& coords, LO children[][4]) {
+    return split_tet(ev, em, eg, coords, children);
+  }
+};
+
+template <Int dim>
+struct ElementSplitter {
+  LOs ev2v;
+  LOs ee2e;
+  LOs edges2midverts;
+  Read<GO> vert_globals;
+  Reals new_coords;
+  DEVICE Int operator()(LO elem, LO children[][4]) const {
+    enum { NEEV = dim + 1, NEEE = (dim * (dim + 1)) / 2 };
+    LO ev[NEEV];
+    GO eg[NEEV];
+    LO em[NEEE];
+    for (Int i = 0; i < NEEV; ++i) {
+      ev[i] = ev2v[elem * NEEV + i];
+      eg[i] = vert_globals[ev[i]];
+    }
+    for (Int i = 0; i < NEEE; ++i) {
+      em[i] = edges2midverts[ee2e[elem * NEEE + i]];
+    }
+    auto n = SimplexSplitter<dim>::split(ev, em, eg, new_coords, children);
+    for (Int i = 0; i < n; ++i) orient_child<dim>(children[i], new_coords);
+    return n;
+  }
+};
+
+template <Int dim>
+static LOs split_elems(Mesh* mesh, LOs edges2midverts, Reals new_coords) {
+  ElementSplitter<dim> split;
+  split.ev2v = mesh->ask_elem_verts();
+  split.ee2e = mesh->ask_down(dim, EDGE).ab2b;
+  split.edges2midverts = edges2midverts;
+  split.vert_globals = mesh->ask_globals(VERT);
+  split.new_coords = new_coords;
+  auto nelems = mesh->nelems();
+  Write<LO> degrees(nelems);
+  auto count = LAMBDA(LO elem) {
+    LO children[MAX_CHILDREN][4];
+    degrees[elem] = split(elem, children);
+  };
+  parallel_for(nelems, count);
+  auto elems2children = offset_scan(LOs(degrees));
+  auto nchildren = elems2children.last();
+  Write<LO> child_verts(nchildren * (dim + 1));
+  auto fill = LAMBDA(LO elem) {
+    LO children[MAX_CHILDREN][4];
+    auto n = split(elem, children);
+    for (Int i = 0; i < n; ++i) {
+      auto child = elems2children[elem] + i;
+      for (Int j = 0; j < dim + 1; ++j) {
+        child_verts[child * (dim + 1) + j] = children[i][j];
+      }
+    }
+  };
+  parallel_for(nelems, fill);
+  return child_verts;
+}
+
+static Read<I8> mark_tets_without_template(Mesh* mesh, Read<I8> marks) {
+  auto te2e = mesh->ask_down(TET, EDGE).ab2b;
+  auto ntets = mesh->nelems();
+  Write<I8> out(ntets);
+  auto f = LAMBDA(LO tet) {
+    Int mask = 0;
+    for (Int e = 0; e < 6; ++e) {
+      if (marks[te2e[tet * 6 + e]]) mask |= (1 << e);
+    }
+    out[tet] = !tet_has_template(mask);
+  };
+  parallel_for(ntets, f);
+  return out;
+}
+
+/* tets whose marked edges are neither all on one face nor all six
+   get all their edges marked, until no such tets remain */
+static Read<I8> close_marks(Mesh* mesh, Read<I8> marks) {
+  if (mesh->dim() != 3) return marks;
+  auto comm = mesh->comm();
+  while (true) {
+    auto tets_need_all = mark_tets_without_template(mesh, marks);
+    if (comm->allreduce(max(tets_need_all), OMEGA_H_MAX) != 1) break;
+    marks = lor_each(marks, mark_down(mesh, TET, EDGE, tets_need_all));
+  }
+  return marks;
+}
+
+/* new vertices after the old ones are numbered by the global
+   numbers of their edges */
+static Read<GO> get_new_vert_globals(Mesh* mesh, Read<I8> marks) {
+  auto comm = mesh->comm();
+  auto old_globals = mesh->ask_globals(VERT);
+  auto nold_verts = mesh->nverts();
+  auto offset = find_total_globals(comm, old_globals);
+  auto edges2lins = copies_to_linear_owners(comm, mesh->ask_globals(EDGE));
+  auto lins2edges = edges2lins.invert();
+  auto nlins = lins2edges.nroots();
+  auto lins_are_marked = edges2lins.exch_reduce(marks, 1, OMEGA_H_MAX);
+  auto lin_local_offsets = offset_scan(lins_are_marked);
+  auto lin_count = lin_local_offsets.last();
+  auto lin_offset = offset + comm->exscan(GO(lin_count), OMEGA_H_SUM);
+  Write<GO> lin_globals(nlins);
+  auto write_lin_globals = LAMBDA(LO lin) {
+    lin_globals[lin] = lin_local_offsets[lin] + lin_offset;
+  };
+  parallel_for(nlins, write_lin_globals);
+  auto edge_globals = lins2edges.exch(Read<GO>(lin_globals), 1);
+  auto marked2edges = collect_marked(marks);
+  auto nmarked = marked2edges.size();
+  Write<GO> new_globals(nold_verts + nmarked);
+  map_into(old_globals, LOs(nold_verts, 0, 1), new_globals, 1);
+  map_into(unmap(marked2edges, edge_globals, 1),
+      LOs(nmarked, nold_verts, 1), new_globals, 1);
+  return new_globals;
+}
+
+/* for each new vertex, the one or two old vertices it lies between */
+static LOs get_new_verts2old_verts(Mesh* mesh, LOs marked2edges) {
+  auto nold_verts = mesh->nverts();
+  auto nmarked = marked2edges.size();
+  auto ev2v = mesh->ask_verts_of(EDGE);
+  Write<LO> out((nold_verts + nmarked) * 2);
+  auto f = LAMBDA(LO v) {
+    if (v < nold_verts) {
+      out[v * 2 + 0] = v;
+      out[v * 2 + 1] = -1;
+    } else {
+      auto edge = marked2edges[v - nold_verts];
+      out[v * 2 + 0] = ev2v[edge * 2 + 0];
+      out[v * 2 + 1] = ev2v[edge * 2 + 1];
+    }
+  };
+  parallel_for(nold_verts + nmarked, f);
+  return out;
+}
+
+struct OldSimplices {
+  LOs verts2ents[4];
+  LOs verts2ents_ents[4];
+  LOs ents2verts[4];
+};
+
+/* each new entity lies inside the old entity spanned by the old
+   vertices around its vertices */
+static void find_parents(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
+    LOs new_verts2old_verts, Read<I8>* p_parent_dims, LOs* p_parents) {
+  OldSimplices old;
+  for (Int d = 1; d <= old_mesh->dim(); ++d) {
+    auto v2e = old_mesh->ask_up(VERT, d);
+    old.verts2ents[d] = v2e.a2ab;
+    old.verts2ents_ents[d] = v2e.ab2b;
+    old.ents2verts[d] = old_mesh->ask_verts_of(d);
+  }
+  auto ev2v = new_mesh->ask_verts_of(ent_dim);
+  auto nents = new_mesh->nents(ent_dim);
+  Write<I8> parent_dims(nents);
+  Write<LO> parents(nents);
+  auto f = LAMBDA(LO ent) {
+    LO u[4];
+    Int n = 0;
+    for (Int i = 0; i <= ent_dim; ++i) {
+      auto v = ev2v[ent * (ent_dim + 1) + i];
+      for (Int j = 0; j < 2; ++j) {
+        auto ov = new_verts2old_verts[v * 2 + j];
+        if (ov < 0) continue;
+        bool found = false;
+        for (Int k = 0; k < n; ++k) found = found || (u[k] == ov);
+        if (!found) u[n++] = ov;
+      }
+    }
+    auto pd = n - 1;
+    parent_dims[ent] = static_cast<I8>(pd);
+    parents[ent] = -1;
+    if (pd == VERT) {
+      parents[ent] = u[0];
+      return;
+    }
+    auto const& v2e = old.verts2ents[pd];
+    auto const& v2e_ents = old.verts2ents_ents[pd];
+    auto const& pv2v = old.ents2verts[pd];
+    for (auto ve = v2e[u[0]]; ve < v2e[u[0] + 1]; ++ve) {
+      auto p = v2e_ents[ve];
+      Int nmatch = 0;
+      for (Int k = 0; k < n; ++k) {
+        for (Int l = 0; l < n; ++l) nmatch += (pv2v[p * n + l] == u[k]);
+      }
+      if (nmatch == n) {
+        parents[ent] = p;
+        break;
+      }
+    }
+  };
+  parallel_for(nents, f);
+  *p_parent_dims = parent_dims;
+  *p_parents = parents;
+}
+
+DEVICE void sort_vert_globals(GO* a, Int n) {
+  for (Int i = 1; i < n; ++i) {
+    for (Int j = i; j > 0 && a[j - 1] > a[j]; --j) {
+      auto tmp = a[j - 1];
+      a[j - 1] = a[j];
+      a[j] = tmp;
+    }
+  }
+}
+
+/* with canonical globals, the new entities of (ent_dim) are numbered
+   in blocks by the dimension of their parents, then by the global
+   numbers of their parents, then among siblings by their sorted
+   vertex global numbers. siblings are the same on every copy of the
+   parent, which also owns its children, as in uniform refinement */
+static void number_children(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
+    Read<I8> parent_dims, LOs parents) {
+  auto comm = old_mesh->comm();
+  auto nents = new_mesh->nents(ent_dim);
+  auto deg = ent_dim + 1;
+  auto ev2v = new_mesh->ask_verts_of(ent_dim);
+  auto vert_globals = new_mesh->ask_globals(VERT);
+  Write<GO> globals(nents);
+  Write<I32> ranks(nents);
+  GO global_start = 0;
+  for (Int pd = ent_dim; pd <= old_mesh->dim(); ++pd) {
+    auto block2ents =
+        collect_marked(each_eq_to(parent_dims, static_cast<I8>(pd)));
+    auto nparents = old_mesh->nents(pd);
+    auto parents2block =
+        invert_map_by_atomics(unmap(block2ents, parents, 1), nparents);
+    auto parents2lins =
+        copies_to_linear_owners(comm, old_mesh->ask_globals(pd));
+    auto lins2parents = parents2lins.invert();
+    auto nlins = lins2parents.nroots();
+    auto lin_nchildren = parents2lins.exch_reduce(
+        get_degrees(parents2block.a2ab), 1, OMEGA_H_MAX);
+    auto lin_local_offsets = offset_scan(lin_nchildren);
+    auto lin_count = lin_local_offsets.last();
+    auto lin_offset =
+        global_start + comm->exscan(GO(lin_count), OMEGA_H_SUM);
+    Write<GO> lin_starts(nlins);
+    auto write_lin_starts = LAMBDA(LO lin) {
+      lin_starts[lin] = lin_local_offsets[lin] + lin_offset;
+    };
+    parallel_for(nlins, write_lin_starts);
+    auto parent_starts = lins2parents.exch(Read<GO>(lin_starts), 1);
+    auto parent_ranks = old_mesh->ask_owners(pd).ranks;
+    auto parents2sibs = parents2block.a2ab;
+    auto sibs2block = parents2block.ab2b;
+    auto f = LAMBDA(LO b) {
+      auto ent = block2ents[b];
+      auto parent = parents[ent];
+      GO key[4];
+      for (Int i = 0; i < deg; ++i) key[i] = vert_globals[ev2v[ent * deg + i]];
+      sort_vert_globals(key, deg);
+      Int nbefore = 0;
+      for (auto ps = parents2sibs[parent]; ps < parents2sibs[parent + 1];
+           ++ps) {
+        auto sib = block2ents[sibs2block[ps]];
+        GO sib_key[4];
+        for (Int i = 0; i < deg; ++i) {
+          sib_key[i] = vert_globals[ev2v[sib * deg + i]];
+        }
+        sort_vert_globals(sib_key, deg);
+        Int i = 0;
+        while (i < deg && sib_key[i] == key[i]) ++i;
+        nbefore += (i < deg && sib_key[i] < key[i]);
+      }
+      globals[ent] = parent_starts[parent] + nbefore;
+      ranks[ent] = parent_ranks[parent];
+    };
+    parallel_for(block2ents.size(), f);
+    global_start += comm->allreduce(GO(lin_count), OMEGA_H_SUM);
+  }
+  new_mesh->set_tag(ent_dim, "global", Read<GO>(globals));
+  if (new_mesh->could_be_shared(ent_dim)) {
+    new_mesh->set_owners(
+        ent_dim, owners_from_globals(comm, globals, Read<I32>(ranks)));
+  }
+}
+
+template <typename T>
+static void transfer_inherit_tmpl(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
+    Read<I8> parent_dims, LOs parents, TagBase const* tagbase) {
+  auto const& name = tagbase->name();
+  auto ncomps = tagbase->ncomps();
+  auto new_data = Write<T>(new_mesh->nents(ent_dim) * ncomps);
+  for (Int pd = ent_dim; pd <= old_mesh->dim(); ++pd) {
+    auto kids2ents = collect_marked(each_eq_to(parent_dims, I8(pd)));
+    if (!kids2ents.size()) continue;
+    auto kids2parents = unmap(kids2ents, parents, 1);
+    auto old_data = old_mesh->get_array<T>(pd, name);
+    map_into(
+        unmap(kids2parents, old_data, ncomps), kids2ents, new_data, ncomps);
+  }
+  new_mesh->add_tag(ent_dim, name, ncomps, tagbase->xfer(),
+      tagbase->outflags(), Read<T>(new_data));
+}
+
+static void transfer_inherit(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
+    Read<I8> parent_dims, LOs parents, TagBase const* tagbase) {
+  switch (tagbase->type()) {
+    case OMEGA_H_I8:
+      transfer_inherit_tmpl<I8>(
+          old_mesh, new_mesh, ent_dim, parent_dims, parents, tagbase);
+      break;
+    case OMEGA_H_I32:
+      transfer_inherit_tmpl<I32>(
+          old_mesh, new_mesh, ent_dim, parent_dims, parents, tagbase);
+      break;
+    case OMEGA_H_I64:
+      transfer_inherit_tmpl<I64>(
+          old_mesh, new_mesh, ent_dim, parent_dims, parents, tagbase);
+      break;
+    case OMEGA_H_F64:
+      transfer_inherit_tmpl<Real>(
+          old_mesh, new_mesh, ent_dim, parent_dims, parents, tagbase);
+      break;
+  }
+}
+
+static void transfer_verts(Mesh* old_mesh, Mesh* new_mesh, LOs marked2edges,
+    Read<I8> parent_dims, LOs parents) {
+  AdaptTimer timer(ADAPT_TRANSFER);
+  auto nold_verts = old_mesh->nverts();
+  auto same_verts = LOs(nold_verts, 0, 1);
+  auto midverts = LOs(marked2edges.size(), nold_verts, 1);
+  for (Int i = 0; i < old_mesh->ntags(VERT); ++i) {
+    auto tagbase = old_mesh->get_tag(VERT, i);
+    auto xfer = tagbase->xfer();
+    if (xfer == OMEGA_H_INHERIT) {
+      transfer_inherit(
+          old_mesh, new_mesh, VERT, parent_dims, parents, tagbase);
+    } else if (xfer == OMEGA_H_LINEAR_INTERP || xfer == OMEGA_H_METRIC) {
+      auto mid_data = midpoint_values(old_mesh, marked2edges, tagbase);
+      transfer_common(old_mesh, new_mesh, VERT, same_verts, same_verts,
+          midverts, tagbase, mid_data);
+    }
+  }
+}
+
+static void transfer_conserve(Mesh* old_mesh, Mesh* new_mesh, LOs parents,
+    TagBase const* tagbase) {
+  auto ncomps = tagbase->ncomps();
+  auto old_data = old_mesh->get_array<Real>(old_mesh->dim(), tagbase->name());
+  auto old_sizes = measure_elements_real(old_mesh);
+  auto new_sizes = measure_elements_real(new_mesh);
+  auto nnew_elems = new_mesh->nelems();
+  Write<Real> new_data(nnew_elems * ncomps);
+  auto f = LAMBDA(LO elem) {
+    auto parent = parents[elem];
+    auto ratio = new_sizes[elem] / old_sizes[parent];
+    for (Int c = 0; c < ncomps; ++c) {
+      new_data[elem * ncomps + c] = old_data[parent * ncomps + c] * ratio;
+    }
+  };
+  parallel_for(nnew_elems, f);
+  new_mesh->add_tag(new_mesh->dim(), tagbase->name(), ncomps,
+      tagbase->xfer(), tagbase->outflags(), Reals(new_data));
+}
+
+static void transfer_ents(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
+    Read<I8> parent_dims, LOs parents) {
+  AdaptTimer timer(ADAPT_TRANSFER);
+  auto dim = old_mesh->dim();
+  for (Int i = 0; i < old_mesh->ntags(ent_dim); ++i) {
+    auto tagbase = old_mesh->get_tag(ent_dim, i);
+    auto xfer = tagbase->xfer();
+    auto const& name = tagbase->name();
+    auto ncomps = tagbase->ncomps();
+    auto outflags = tagbase->outflags();
+    if (xfer == OMEGA_H_INHERIT ||
+        (ent_dim == dim && (xfer == OMEGA_H_POINTWISE ||
+                               xfer == OMEGA_H_CONSERVE_R3D))) {
+      transfer_inherit(
+          old_mesh, new_mesh, ent_dim, parent_dims, parents, tagbase);
+    } else if (ent_dim == dim && xfer == OMEGA_H_CONSERVE) {
+      transfer_conserve(old_mesh, new_mesh, parents, tagbase);
+    } else if (ent_dim == EDGE && xfer == OMEGA_H_LENGTH) {
+      new_mesh->add_tag(EDGE, name, ncomps, xfer, outflags,
+          measure_edges_metric(new_mesh));
+    } else if (ent_dim == dim && xfer == OMEGA_H_QUALITY) {
+      new_mesh->add_tag(
+          dim, name, ncomps, xfer, outflags, measure_qualities(new_mesh));
+    }
+  }
+}
+
+static Reals get_new_coords(Mesh* mesh, LOs marked2edges) {
+  auto dim = mesh->dim();
+  auto nold_verts = mesh->nverts();
+  auto nmarked = marked2edges.size();
+  auto coords = mesh->coords();
+  Write<Real> new_coords((nold_verts + nmarked) * dim);
+  map_into(coords, LOs(nold_verts, 0, 1), new_coords, dim);
+  map_into(average_field(mesh, EDGE, marked2edges, dim, coords),
+      LOs(nmarked, nold_verts, 1), new_coords, dim);
+  return new_coords;
+}
+
+static void refine_marked(Mesh* mesh, Read<I8> marks) {
+  auto dim = mesh->dim();
+  auto nold_verts = mesh->nverts();
+  auto marked2edges = collect_marked(marks);
+  record_adapt_keys(mesh, EDGE, marked2edges);
+  AdaptTimer timer(ADAPT_MODIFICATION);
+  auto nmarked = marked2edges.size();
+  auto edges2midverts =
+      map_onto(LOs(nmarked, nold_verts, 1), marked2edges, mesh->nedges(),
+          -1, 1);
+  auto new_coords = get_new_coords(mesh, marked2edges);
+  auto new_vert_globals = get_new_vert_globals(mesh, marks);
+  LOs new_ev2v;
+  if (dim == 3) {
+    new_ev2v = split_elems<3>(mesh, edges2midverts, new_coords);
+  } else {
+    new_ev2v = split_elems<2>(mesh, edges2midverts, new_coords);
+  }
+  auto new_mesh = mesh->copy_meta();
+  build_ents_from_elems2verts(&new_mesh, new_ev2v, new_vert_globals);
+  auto new_verts2old_verts = get_new_verts2old_verts(mesh, marked2edges);
+  for (Int ent_dim = 0; ent_dim <= dim; ++ent_dim) {
+    Read<I8> parent_dims;
+    LOs parents;
+    find_parents(mesh, &new_mesh, ent_dim, new_verts2old_verts, &parent_dims,
+        &parents);
+    if (ent_dim == VERT) {
+      transfer_verts(mesh, &new_mesh, marked2edges, parent_dims, parents);
+    } else {
+      if (mesh->keeps_canonical_globals()) {
+        number_children(mesh, &new_mesh, ent_dim, parent_dims, parents);
+      }
+      transfer_ents(mesh, &new_mesh, ent_dim, parent_dims, parents);
+    }
+  }
+  *mesh = new_mesh;
+}
+
+/* how many children of each dimension (row) an old entity of each
+   dimension (column) has under uniform refinement. new entities are
+   numbered in blocks by the dimension of their parents, and within a
+   block by parent, both locally and globally */
+static Int const uniform_nchildren[4][4] = {
+    {1, 1, 0, 0}, {0, 2, 3, 1}, {0, 0, 4, 8}, {0, 0, 0, 8}};
+
+static LO count_uniform_children(Mesh* mesh, Int ent_dim) {
+  LO n = 0;
+  for (Int pd = VERT; pd <= mesh->dim(); ++pd) {
+    n += uniform_nchildren[ent_dim][pd] * mesh->nents(pd);
+  }
+  return n;
+}
+
+static void split_edges_uniformly(Mesh* mesh, Write<LO> edge_verts) {
+  auto nverts = mesh->nverts();
+  auto ev2v = mesh->ask_verts_of(EDGE);
+  auto f = LAMBDA(LO edge) {
+    auto midvert = nverts + edge;
+    edge_verts[(edge * 2 + 0) * 2 + 0] = ev2v[edge * 2 + 0];
+    edge_verts[(edge * 2 + 0) * 2 + 1] = midvert;
+    edge_verts[(edge * 2 + 1) * 2 + 0] = midvert;
+    edge_verts[(edge * 2 + 1) * 2 + 1] = ev2v[edge * 2 + 1];
+  };
+  parallel_for(mesh->nedges(), f);
+}
+
+template <Int dim>
+static void split_tris_uniformly(Mesh* mesh, Reals new_coords,
+    Write<LO> edge_verts, Write<LO> tri_verts) {
+  auto nverts = mesh->nverts();
+  auto edge_start = 2 * mesh->nedges();
+  auto fv2v = mesh->ask_verts_of(TRI);
+  auto fe2e = mesh->ask_down(TRI, EDGE).ab2b;
+  auto f = LAMBDA(LO tri) {
+    LO fv[3];
+    LO fm[3];
+    GO fg[3] = {0, 0, 0};
+    for (Int k = 0; k < 3; ++k) {
+      fv[k] = fv2v[tri * 3 + k];
+      fm[k] = nverts + fe2e[tri * 3 + k];
+    }
+    for (Int k = 0; k < 3; ++k) {
+      auto edge = edge_start + tri * 3 + k;
+      edge_verts[edge * 2 + 0] = fm[k];
+      edge_verts[edge * 2 + 1] = fm[(k + 1) % 3];
+    }
+    LO children[4][4];
+    split_face(fv, fm, fg, children);
+    for (Int i = 0; i < 4; ++i) {
+      if (dim == TRI) orient_child<TRI>(children[i], new_coords);
+      for (Int j = 0; j < 3; ++j) {
+        tri_verts[(tri * 4 + i) * 3 + j] = children[i][j];
+      }
+    }
+  };
+  parallel_for(mesh->ntris(), f);
+}
+
+static void split_tets_uniformly(Mesh* mesh, Reals new_coords,
+    Write<LO> edge_verts, Write<LO> tri_verts, Write<LO> tet_verts) {
+  auto nverts = mesh->nverts();
+  auto edge_start = 2 * mesh->nedges() + 3 * mesh->ntris();
+  auto tri_start = 4 * mesh->ntris();
+  auto rv2v = mesh->ask_verts_of(TET);
+  auto re2e = mesh->ask_down(TET, EDGE).ab2b;
+  auto f = LAMBDA(LO tet) {
+    LO ev[4];
+    LO em[6];
+    for (Int i = 0; i < 4; ++i) ev[i] = rv2v[tet * 4 + i];
+    for (Int i = 0; i < 6; ++i) em[i] = nverts + re2e[tet * 6 + i];
+    auto d = octahedron_diagonal(em, new_coords);
+    auto od = OppositeTemplate<3, 1>::get(d);
+    Int ring[4];
+    octahedron_ring(d, ring);
+    auto edge = edge_start + tet;
+    edge_verts[edge * 2 + 0] = em[d];
+    edge_verts[edge * 2 + 1] = em[od];
+    LO tris[8][4];
+    for (Int i = 0; i < 4; ++i) {
+      Int n = 0;
+      for (Int j = 0; j < 4; ++j) {
+        if (j != i) tris[i][n++] = em[tet_edge_between(i, j)];
+      }
+    }
+    for (Int k = 0; k < 4; ++k) {
+      set_child(tris[4 + k], em[d], em[od], em[ring[k]]);
+    }
+    for (Int i = 0; i < 8; ++i) {
+      for (Int j = 0; j < 3; ++j) {
+        tri_verts[(tri_start + tet * 8 + i) * 3 + j] = tris[i][j];
+      }
+    }
+    LO children[8][4];
+    split_tet_all(ev, em, new_coords, children);
+    for (Int i = 0; i < 8; ++i) {
+      orient_child<3>(children[i], new_coords);
+      for (Int j = 0; j < 4; ++j) {
+        tet_verts[(tet * 8 + i) * 4 + j] = children[i][j];
+      }
+    }
+  };
+  parallel_for(mesh->ntets(), f);
+}
+
+/* gives the new entities of (ent_dim) their global numbers and
+   owners, which are the owners of their parents */
+static void number_uniform_children(Mesh* old_mesh, Mesh* new_mesh,
+    Int ent_dim, Read<I8>* p_parent_dims, LOs* p_parents) {
+  auto comm = old_mesh->comm();
+  auto nents = new_mesh->nents(ent_dim);
+  Write<GO> globals(nents);
+  Write<I32> ranks(nents);
+  Write<LO> idxs(nents);
+  Write<I8> parent_dims(nents);
+  Write<LO> parents(nents);
+  LO local_start = 0;
+  GO global_start = 0;
+  for (Int pd = VERT; pd <= old_mesh->dim(); ++pd) {
+    Int nper = uniform_nchildren[ent_dim][pd];
+    if (!nper) continue;
+    auto nparents = old_mesh->nents(pd);
+    auto parent_globals = old_mesh->ask_globals(pd);
+    auto parent_ranks = old_mesh->ask_owners(pd).ranks;
+    auto owner_starts =
+        old_mesh->sync_array(pd, LOs(nparents, local_start, nper), 1);
+    auto f = LAMBDA(LO parent) {
+      for (Int k = 0; k < nper; ++k) {
+        auto ent = local_start + parent * nper + k;
+        globals[ent] = global_start + parent_globals[parent] * nper + k;
+        ranks[ent] = parent_ranks[parent];
+        idxs[ent] = owner_starts[parent] + k;
+        parent_dims[ent] = static_cast<I8>(pd);
+        parents[ent] = parent;
+      }
+    };
+    parallel_for(nparents, f);
+    local_start += nparents * nper;
+    global_start += find_total_globals(comm, parent_globals) * nper;
+  }
+  new_mesh->set_owners(ent_dim, Remotes(Read<I32>(ranks), LOs(idxs)));
+  new_mesh->add_tag(ent_dim, "global", 1, OMEGA_H_GLOBAL, OMEGA_H_DO_OUTPUT,
+      Read<GO>(globals));
+  *p_parent_dims = parent_dims;
+  *p_parents = parents;
+}
+
+static void refine_uniformly_once(Mesh* mesh) {
+  auto dim = mesh->dim();
+  auto nverts = mesh->nverts();
+  auto all_edges = LOs(mesh->nedges(), 0, 1);
+  auto new_coords = get_new_coords(mesh, all_edges);
+  Write<LO> ent_verts[4];
+  for (Int ent_dim = EDGE; ent_dim <= dim; ++ent_dim) {
+    ent_verts[ent_dim] =
+        Write<LO>(count_uniform_children(mesh, ent_dim) * (ent_dim + 1));
+  }
+  split_edges_uniformly(mesh, ent_verts[EDGE]);
+  if (dim == 3) {
+    split_tris_uniformly<3>(mesh, new_coords, ent_verts[EDGE], ent_verts[TRI]);
+    split_tets_uniformly(mesh, new_coords, ent_verts[EDGE], ent_verts[TRI],
+        ent_verts[TET]);
+  } else {
+    split_tris_uniformly<2>(mesh, new_coords, ent_verts[EDGE], ent_verts[TRI]);
+  }
+  auto new_mesh = mesh->copy_meta();
+  new_mesh.set_verts(count_uniform_children(mesh, VERT));
+  for (Int ent_dim = VERT; ent_dim <= dim; ++ent_dim) {
+    if (ent_dim == EDGE) {
+      new_mesh.set_ents(EDGE, Adj(LOs(ent_verts[EDGE])));
+    } else if (ent_dim > EDGE) {
+      auto ldim = ent_dim - 1;
+      auto down = reflect_down(LOs(ent_verts[ent_dim]),
+          new_mesh.ask_verts_of(ldim), new_mesh.ask_up(VERT, ldim), ent_dim,
+          ldim);
+      new_mesh.set_ents(ent_dim, down);
+    }
+    Read<I8> parent_dims;
+    LOs parents;
+    number_uniform_children(mesh, &new_mesh, ent_dim, &parent_dims, &parents);
+    if (ent_dim == VERT) {
+      transfer_verts(mesh, &new_mesh, all_edges, parent_dims, parents);
+    } else {
+      transfer_ents(mesh, &new_mesh, ent_dim, parent_dims, parents);
+    }
+  }
+  CHECK(new_mesh.nverts() == nverts + all_edges.size());
+  *mesh = new_mesh;
+}
+
+}  // end namespace refine_templates
+
+bool refine_by_templates(Mesh* mesh, Read<I8> edges_are_marked, bool verbose) {
+  auto comm = mesh->comm();
+  CHECK(comm->size() == 1 || mesh->parting() == OMEGA_H_ELEM_BASED);
+  if (comm->allreduce(max(edges_are_marked), OMEGA_H_MAX) != 1) return false;
+  record_adapt_cands(mesh, EDGE, edges_are_marked);
+  auto marks = refine_templates::close_marks(mesh, edges_are_marked);
+  if (verbose) {
+    auto nmarked = sum(comm, land_each(marks, mesh->owned(EDGE)));
+    if (comm->rank() == 0) {
+      std::cout << "refining " << nmarked << " edges by templates\n";
+    }
+  }
+  refine_templates::refine_marked(mesh, marks);
+  return true;
+}
+
+void refine_uniformly(Mesh* mesh, Int nlevels) {
+  mesh->set_parting(OMEGA_H_ELEM_BASED);
+  for (Int i = 0; i < nlevels; ++i) {
+    refine_templates::refine_uniformly_once(mesh);
+  }
+}
+
+bool refine_by_templates(
+    Mesh* mesh, Real max_len, bool verbose, Read<I8> elems_are_in) {
+  mesh->set_parting(OMEGA_H_ELEM_BASED);
+  auto edges_are_marked = each_gt(mesh->ask_lengths(), max_len);
+  edges_are_marked =
+      restrict_to_region(mesh, EDGE, edges_are_marked, elems_are_in);
+  return refine_by_templates(mesh, edges_are_marked, verbose);
+}
+
+}  // end namespace Omega_h
@@ -0,0 +1,33 @@
+#ifndef REFINE_TEMPLATES_HPP
+#define REFINE_TEMPLATES_HPP
+
+#include "internal.hpp"
+
+namespace Omega_h {
+
+/* splits all marked edges at once, cutting each element by the
+   template for its set of marked edges: triangles 1:2, 1:3 and 1:4,
+   tets 1:2, 1:3 and 1:4 (all marked edges on one face) and 1:8.
+   other sets of marked edges of a tet are closed by marking all six.
+   (edges_are_marked) must agree on all copies of an edge, and the
+   mesh must be element-based.
+   unlike refine(), element qualities are not checked.
+   new vertices are numbered after the old ones by the global numbers
+   of their edges. if the mesh keeps canonical globals (the default),
+   every edge, face and element of the new mesh is numbered in blocks
+   by the dimension of its parent, then by the parent's global number,
+   then among siblings by sorted vertex global numbers, and is owned
+   by the owner of its parent, so the numbering does not depend on
+   the partitioning. otherwise those entities are numbered and owned
+   as build_ents_from_elems2verts() decides.
+   returns false if no edges are marked */
+bool refine_by_templates(Mesh* mesh, Read<I8> edges_are_marked, bool verbose);
+/* as above, marking all edges longer than (max_len), or only those
+   among the edges of the elements marked by (elems_are_in) if it
+   exists, which must then be given on the element-based mesh */
+bool refine_by_templates(Mesh* mesh, Real max_len, bool verbose,
+    Read<I8> elems_are_in = Read<I8>());
+
+}  // end namespace Omega_h
+
+#endif
@@ -1,5 +1,6 @@
 #include "swap.hpp"
 
+#include "adapt_stats.hpp"
 #include "array.hpp"
 #include "graph.hpp"
 #include "map.hpp"
@@ -9,14 +10,17 @@
 
 namespace Omega_h {
 
-bool swap_part1(Mesh* mesh, Real qual_ceil, Int nlayers) {
+bool swap_part1(
+    Mesh* mesh, Real qual_ceil, Int nlayers, Read<I8> elems_are_in) {
   mesh->set_parting(OMEGA_H_GHOSTED);
   auto comm = mesh->comm();
-  auto elems_are_cands = mark_sliver_layers(mesh, qual_ceil, nlayers);
+  auto elems_are_cands =
+      mark_sliver_layers(mesh, qual_ceil, nlayers, elems_are_in);
   CHECK(comm->allreduce(max(elems_are_cands), OMEGA_H_MAX) == 1);
   auto edges_are_cands = mark_down(mesh, mesh->dim(), EDGE, elems_are_cands);
   auto edges_are_inter = mark_by_class_dim(mesh, EDGE, mesh->dim());
   edges_are_cands = land_each(edges_are_cands, edges_are_inter);
+  record_adapt_cands(mesh, EDGE, edges_are_cands);
   /* only swap interior edges */
   if (comm->reduce_and(max(edges_are_cands) <= 0)) return false;
   mesh->add_tag(EDGE, "candidate", 1, OMEGA_H_DONT_TRANSFER,
@@ -37,9 +41,14 @@ void filter_swap_improve(Mesh* mesh, LOs* cands2edges, Reals* cand_quals) {
   *cand_quals = unmap(kept2old, *cand_quals, 1);
 }
 
-bool swap_edges(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose) {
-  if (mesh->dim() == 3) return run_swap3d(mesh, qual_ceil, nlayers, verbose);
-  if (mesh->dim() == 2) return swap2d(mesh, qual_ceil, nlayers, verbose);
+bool swap_edges(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose,
+    Read<I8> elems_are_in) {
+  if (mesh->dim() == 3) {
+    return run_swap3d(mesh, qual_ceil, nlayers, verbose, elems_are_in);
+  }
+  if (mesh->dim() == 2) {
+    return swap2d(mesh, qual_ceil, nlayers, verbose, elems_are_in);
+  }
   return false;
 }
 
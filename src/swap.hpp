@@ -5,11 +5,14 @@
 
 namespace Omega_h {
 
-bool swap_part1(Mesh* mesh, Real qual_ceil, Int nlayers);
+bool swap_part1(Mesh* mesh, Real qual_ceil, Int nlayers, Read<I8> elems_are_in);
 
 void filter_swap_improve(Mesh* mesh, LOs* cands2edges, Reals* cand_quals);
 
-bool swap_edges(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose);
+/* only edges of the elements marked by (elems_are_in), if it
+   exists, are candidates. it must be given on the ghosted mesh */
+bool swap_edges(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose,
+    Read<I8> elems_are_in = Read<I8>());
 
 }  // end namespace Omega_h
 
@@ -2,6 +2,7 @@
 
 #include <iostream>
 
+#include "adapt_stats.hpp"
 #include "indset.hpp"
 #include "map.hpp"
 #include "modify.hpp"
@@ -41,6 +42,9 @@ static void swap2d_element_based(Mesh* mesh, bool verbose) {
       std::cout << "swapping " << ntotal_keys << " 2D edges\n";
     }
   }
+  record_adapt_keys(mesh, EDGE, keys2edges);
+  AdaptTimer timer(ADAPT_MODIFICATION);
+  release_for_modify(mesh);
   auto new_mesh = mesh->copy_meta();
   new_mesh.set_verts(mesh->nverts());
   new_mesh.set_owners(VERT, mesh->ask_owners(VERT));
@@ -49,23 +53,28 @@ static void swap2d_element_based(Mesh* mesh, bool verbose) {
   HostFew<LOs, 3> prod_verts2verts;
   swap2d_topology(mesh, keys2edges, &keys2prods, &prod_verts2verts);
   auto old_lows2new_lows = LOs(mesh->nverts(), 0, 1);
+  auto low_prods2new_lows = LOs();
   for (Int ent_dim = EDGE; ent_dim <= 2; ++ent_dim) {
     auto prods2new_ents = LOs();
     auto same_ents2old_ents = LOs();
     auto same_ents2new_ents = LOs();
     auto old_ents2new_ents = LOs();
     modify_ents(mesh, &new_mesh, ent_dim, EDGE, keys2edges, keys2prods[ent_dim],
-        prod_verts2verts[ent_dim], old_lows2new_lows, &prods2new_ents,
+        prod_verts2verts[ent_dim], old_lows2new_lows, low_prods2new_lows,
+        &prods2new_ents,
         &same_ents2old_ents, &same_ents2new_ents, &old_ents2new_ents);
     transfer_swap(mesh, &new_mesh, ent_dim, keys2edges, keys2prods[ent_dim],
         prods2new_ents, same_ents2old_ents, same_ents2new_ents);
     old_lows2new_lows = old_ents2new_ents;
+    low_prods2new_lows = prods2new_ents;
+    release_modified_dim(mesh, ent_dim, EDGE);
   }
   *mesh = new_mesh;
 }
 
-bool swap2d(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose) {
-  if (!swap_part1(mesh, qual_ceil, nlayers)) return false;
+bool swap2d(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose,
+    Read<I8> elems_are_in) {
+  if (!swap_part1(mesh, qual_ceil, nlayers, elems_are_in)) return false;
   if (!swap2d_ghosted(mesh)) return false;
   mesh->set_parting(OMEGA_H_ELEM_BASED);
   swap2d_element_based(mesh, verbose);
@@ -13,7 +13,8 @@ Few<LOs, 4> swap3d_keys_to_prods(Mesh* mesh, LOs keys2edges);
 Few<LOs, 4> swap3d_topology(
     Mesh* mesh, LOs keys2edges, Read<I8> edge_configs, Few<LOs, 4> keys2prods);
 
-bool run_swap3d(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose);
+bool run_swap3d(Mesh* mesh, Real qual_ceil, Int nlayers, bool verbose,
+    Read<I8> elems_are_in);
 
 }  // end namespace Omega_h
 
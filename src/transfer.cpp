@@ -1,6 +1,7 @@
 #include "transfer.hpp"
 
 #include "access.hpp"
+#include "adapt_stats.hpp"
 #include "fit.hpp"
 #include "loop.hpp"
 #include "map.hpp"
@@ -29,16 +30,29 @@ void transfer_common(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
   new_mesh->add_tag(ent_dim, name, ncomps, xfer, outflags, Read<T>(new_data));
 }
 
+Reals midpoint_values(Mesh* mesh, LOs edges, TagBase const* tagbase) {
+  auto const& name = tagbase->name();
+  if (mesh->has_tag_function(name)) {
+    auto dim = mesh->dim();
+    auto coords = average_field(mesh, EDGE, edges, dim, mesh->coords());
+    auto values = mesh->get_tag_function(name)(coords);
+    CHECK(values.size() == edges.size() * tagbase->ncomps());
+    return values;
+  }
+  auto old_data = mesh->get_array<Real>(VERT, name);
+  if (tagbase->xfer() == OMEGA_H_METRIC) {
+    return average_metric(mesh, EDGE, edges, old_data);
+  }
+  return average_field(mesh, EDGE, edges, tagbase->ncomps(), old_data);
+}
+
 static void transfer_linear_interp(Mesh* old_mesh, Mesh* new_mesh,
     LOs keys2edges, LOs keys2midverts, LOs same_verts2old_verts,
     LOs same_verts2new_verts) {
   for (Int i = 0; i < old_mesh->ntags(VERT); ++i) {
     auto tagbase = old_mesh->get_tag(VERT, i);
     if (tagbase->xfer() == OMEGA_H_LINEAR_INTERP) {
-      auto ncomps = tagbase->ncomps();
-      auto old_data = old_mesh->get_array<Real>(VERT, tagbase->name());
-      auto prod_data =
-          average_field(old_mesh, EDGE, keys2edges, ncomps, old_data);
+      auto prod_data = midpoint_values(old_mesh, keys2edges, tagbase);
       transfer_common(old_mesh, new_mesh, VERT, same_verts2old_verts,
           same_verts2new_verts, keys2midverts, tagbase, prod_data);
     }
@@ -50,8 +64,7 @@ static void transfer_metric(Mesh* old_mesh, Mesh* new_mesh, LOs keys2edges,
   for (Int i = 0; i < old_mesh->ntags(VERT); ++i) {
     auto tagbase = old_mesh->get_tag(VERT, i);
     if (tagbase->xfer() == OMEGA_H_METRIC) {
-      auto old_data = old_mesh->get_array<Real>(VERT, tagbase->name());
-      auto prod_data = average_metric(old_mesh, EDGE, keys2edges, old_data);
+      auto prod_data = midpoint_values(old_mesh, keys2edges, tagbase);
       transfer_common(old_mesh, new_mesh, VERT, same_verts2old_verts,
           same_verts2new_verts, keys2midverts, tagbase, prod_data);
     }
@@ -189,6 +202,7 @@ static void transfer_quality(Mesh* old_mesh, Mesh* new_mesh,
 void transfer_refine(Mesh* old_mesh, Mesh* new_mesh, LOs keys2edges,
     LOs keys2midverts, Int prod_dim, LOs keys2prods, LOs prods2new_ents,
     LOs same_ents2old_ents, LOs same_ents2new_ents) {
+  AdaptTimer timer(ADAPT_TRANSFER);
   transfer_inherit_refine(old_mesh, new_mesh, keys2edges, prod_dim, keys2prods,
       prods2new_ents, same_ents2old_ents, same_ents2new_ents);
   if (prod_dim == VERT) {
@@ -399,6 +413,7 @@ static void transfer_pointwise_coarsen(Mesh* old_mesh, Mesh* new_mesh,
 void transfer_coarsen(Mesh* old_mesh, Mesh* new_mesh, LOs keys2verts,
     Adj keys2doms, Int prod_dim, LOs prods2new_ents, LOs same_ents2old_ents,
     LOs same_ents2new_ents) {
+  AdaptTimer timer(ADAPT_TRANSFER);
   if (prod_dim == VERT) {
     transfer_no_products(
         old_mesh, new_mesh, prod_dim, same_ents2old_ents, same_ents2new_ents);
@@ -435,6 +450,7 @@ static void transfer_copy_tmpl(
 }
 
 void transfer_copy(Mesh* old_mesh, Mesh* new_mesh, Int prod_dim) {
+  AdaptTimer timer(ADAPT_TRANSFER);
   for (Int i = 0; i < old_mesh->ntags(prod_dim); ++i) {
     auto tagbase = old_mesh->get_tag(prod_dim, i);
     if (tagbase->xfer() != OMEGA_H_DONT_TRANSFER) {
@@ -549,6 +565,7 @@ static void transfer_pointwise_swap(Mesh* old_mesh, Mesh* new_mesh,
 void transfer_swap(Mesh* old_mesh, Mesh* new_mesh, Int prod_dim, LOs keys2edges,
     LOs keys2prods, LOs prods2new_ents, LOs same_ents2old_ents,
     LOs same_ents2new_ents) {
+  AdaptTimer timer(ADAPT_TRANSFER);
   if (prod_dim == VERT) {
     transfer_copy(old_mesh, new_mesh, prod_dim);
   } else {
@@ -19,6 +19,11 @@ void transfer_swap(Mesh* old_mesh, Mesh* new_mesh, Int prod_dim, LOs keys2edges,
 
 void transfer_copy(Mesh* old_mesh, Mesh* new_mesh, Int prod_dim);
 
+/* values of the vertex tag (tagbase) at the midpoints of (edges):
+   its tag function if it has one, otherwise the average (or the
+   metric average, for OMEGA_H_METRIC) of the edge's vertices */
+Reals midpoint_values(Mesh* mesh, LOs edges, TagBase const* tagbase);
+
 template <typename T>
 void transfer_common(Mesh* old_mesh, Mesh* new_mesh, Int ent_dim,
     LOs same_ents2old_ents, LOs same_ents2new_ents, LOs prods2new_ents,
@@ -523,6 +523,45 @@ static void test_linpart() {
   CHECK(remotes.idxs == Read<I32>({2, 1, 0, 3, 2, 1, 0}));
 }
 
+static void test_array_bytes() {
+#ifndef OMEGA_H_USE_KOKKOS
+  auto before = array_bytes_in_use();
+  reset_array_bytes_peak();
+  {
+    Write<Real> a(100);
+    auto b = Reals(a);
+    CHECK(array_bytes_in_use() == before + 100 * I64(sizeof(Real)));
+  }
+  CHECK(array_bytes_in_use() == before);
+  CHECK(array_bytes_peak() == before + 100 * I64(sizeof(Real)));
+  reset_array_bytes_peak();
+  CHECK(array_bytes_peak() == before);
+#endif
+}
+
+#ifndef OMEGA_H_USE_KOKKOS
+/* the peak array memory of one refinement pass over a new mesh.
+   with (keep_old), a copy holds on to the old mesh data,
+   so that releasing it during modification frees nothing */
+static I64 refine_peak_bytes(Library const& lib, bool keep_old) {
+  Mesh mesh;
+  build_box(&mesh, lib, 1, 1, 1, 4, 4, 4);
+  classify_by_angles(&mesh, PI / 4);
+  mesh.add_tag(VERT, "size", 1, OMEGA_H_LINEAR_INTERP, OMEGA_H_DO_OUTPUT,
+      Reals(mesh.nverts(), 0.1));
+  Mesh old;
+  if (keep_old) old = mesh;
+  auto before = array_bytes_in_use();
+  reset_array_bytes_peak();
+  CHECK(refine_by_size(&mesh, 1.5, 0.0, false));
+  return array_bytes_peak() - before;
+}
+
+static void test_release_modified(Library const& lib) {
+  CHECK(refine_peak_bytes(lib, false) < refine_peak_bytes(lib, true));
+}
+#endif
+
 static void test_expand() {
   auto fan = offset_scan(LOs({2, 1, 3}));
   Reals data({2.2, 3.14, 42.0});
@@ -585,6 +624,327 @@ static void test_mark_up_down(Library const& lib) {
   CHECK(mark_up(&mesh, VERT, TRI, Read<I8>({0, 1, 0, 0})) == Read<I8>({1, 0}));
 }
 
+static void test_indset(Library const& lib) {
+  Mesh mesh;
+  build_box(&mesh, lib, 256, 1, 0, 256, 1, 0);
+  auto nverts = mesh.nverts();
+  /* all ties, numbered along the strip */
+  Int nrounds;
+  auto marks = find_indset(
+      &mesh, VERT, Reals(nverts, 1.0), Read<I8>(nverts, 1), &nrounds);
+  /* breaking ties by global IDs alone takes about a round per column
+     of the strip (260 here), hashed ties only a few */
+  CHECK(nrounds <= 16);
+  auto star = mesh.ask_star(VERT);
+  auto v2vv = HostRead<LO>(star.a2ab);
+  auto vv2v = HostRead<LO>(star.ab2b);
+  auto h_marks = HostRead<I8>(marks);
+  for (LO v = 0; v < nverts; ++v) {
+    bool has_in_neighbor = false;
+    for (auto vv = v2vv[v]; vv < v2vv[v + 1]; ++vv) {
+      if (h_marks[vv2v[vv]]) has_in_neighbor = true;
+    }
+    /* independent and maximal */
+    CHECK(!(h_marks[v] && has_in_neighbor));
+    CHECK(h_marks[v] || has_in_neighbor);
+  }
+}
+
+static void test_colors(Library const& lib, Int dim) {
+  Mesh mesh;
+  build_box(&mesh, lib, 1, 1, dim - 2, 3, 3, dim - 2);
+  for (Int ent_dim = 1; ent_dim <= dim; ++ent_dim) {
+    auto colors2ents = mesh.ask_colors(ent_dim);
+    auto c2ce = HostRead<LO>(colors2ents.a2ab);
+    auto ce2e = HostRead<LO>(colors2ents.ab2b);
+    auto ev2v = HostRead<LO>(mesh.ask_verts_of(ent_dim));
+    auto nverts_per_ent = ent_dim + 1;
+    CHECK(ce2e.size() == mesh.nents(ent_dim));
+    std::vector<I8> seen(mesh.nents(ent_dim), 0);
+    for (LO c = 0; c + 1 < c2ce.size(); ++c) {
+      std::vector<I8> touched(mesh.nverts(), 0);
+      for (auto ce = c2ce[c]; ce < c2ce[c + 1]; ++ce) {
+        auto e = ce2e[ce];
+        CHECK(!seen[e]);
+        seen[e] = 1;
+        for (Int i = 0; i < nverts_per_ent; ++i) {
+          auto v = ev2v[e * nverts_per_ent + i];
+          CHECK(!touched[v]);
+          touched[v] = 1;
+        }
+      }
+    }
+  }
+}
+
+static void test_colors(Library const& lib) {
+  test_colors(lib, 2);
+  test_colors(lib, 3);
+}
+
+static void check_refined_by_templates(Mesh* mesh, Real size, Real mass) {
+  auto dim = mesh->dim();
+  auto sizes = measure_elements_real(mesh);
+  CHECK(min(sizes) > 0.0);
+  CHECK(are_close(repro_sum(sizes), size));
+  CHECK(are_close(repro_sum(mesh->get_array<Real>(dim, "mass")), mass));
+  /* a non-conforming split would leave interior sides exposed */
+  auto sides_are_exposed = mark_exposed_sides(mesh);
+  auto side_class_dims = mesh->get_array<I8>(dim - 1, "class_dim");
+  auto interior = each_eq_to(side_class_dims, I8(dim));
+  CHECK(max(land_each(sides_are_exposed, interior)) == 0);
+}
+
+static void test_refine_by_templates(Library const& lib, Int dim) {
+  Mesh mesh;
+  build_box(&mesh, lib, 1, 1, dim - 2, 2, 2, dim - 2);
+  classify_by_angles(&mesh, PI / 4);
+  auto nelems = mesh.nelems();
+  auto size = repro_sum(measure_elements_real(&mesh));
+  mesh.add_tag(dim, "mass", 1, OMEGA_H_CONSERVE, OMEGA_H_DO_OUTPUT,
+      Reals(nelems, 1.0));
+  CHECK(!refine_by_templates(&mesh, Read<I8>(mesh.nedges(), 0), false));
+  CHECK(refine_by_templates(&mesh, Read<I8>(mesh.nedges(), 1), false));
+  CHECK(mesh.nelems() == nelems * (1 << dim));
+  check_refined_by_templates(&mesh, size, Real(nelems));
+  /* only the edges around one vertex, leaving partially split elements */
+  auto verts_are_marked = each_eq_to(LOs(mesh.nverts(), 0, 1), 0);
+  auto edges_are_marked = mark_up(&mesh, VERT, EDGE, verts_are_marked);
+  auto nverts = mesh.nverts();
+  CHECK(refine_by_templates(&mesh, edges_are_marked, false));
+  CHECK(mesh.nverts() > nverts);
+  check_refined_by_templates(&mesh, size, Real(nelems));
+}
+
+static void test_refine_by_templates(Library const& lib) {
+  test_refine_by_templates(lib, 2);
+  test_refine_by_templates(lib, 3);
+}
+
+static void test_refine_uniformly(Library const& lib, Int dim) {
+  Mesh mesh;
+  build_box(&mesh, lib, 1, 1, dim - 2, 2, 2, dim - 2);
+  classify_by_angles(&mesh, PI / 4);
+  auto nelems = mesh.nelems();
+  mesh.add_tag(dim, "mass", 1, OMEGA_H_CONSERVE, OMEGA_H_DO_OUTPUT,
+      Reals(nelems, 1.0));
+  auto by_templates = mesh;
+  for (Int i = 0; i < 2; ++i) {
+    refine_by_templates(&by_templates, Read<I8>(by_templates.nedges(), 1),
+        false);
+  }
+  refine_uniformly(&mesh, 2);
+  CHECK(mesh.nelems() == nelems * (1 << (2 * dim)));
+  for (Int ent_dim = 0; ent_dim <= dim; ++ent_dim) {
+    CHECK(mesh.nents(ent_dim) == by_templates.nents(ent_dim));
+  }
+  check_refined_by_templates(&mesh, 1.0, Real(nelems));
+}
+
+static void test_refine_uniformly(Library const& lib) {
+  test_refine_uniformly(lib, 2);
+  test_refine_uniformly(lib, 3);
+}
+
+static void test_adapt_stats(Library const& lib) {
+  Mesh mesh;
+  build_box(&mesh, lib, 1, 1, 0, 2, 2, 0);
+  classify_by_angles(&mesh, PI / 4);
+  mesh.add_tag(VERT, "size", 1, OMEGA_H_LINEAR_INTERP, OMEGA_H_DO_OUTPUT,
+      Reals(mesh.nverts(), 0.2));
+  AdaptStats stats;
+  AdaptOpts opts;
+  opts.verbosity = 0;
+  opts.stats = &stats;
+  CHECK(adapt(&mesh, opts));
+  CHECK(!stats.passes.empty());
+  CHECK(stats.passes.front().op == "refine");
+  CHECK(stats.passes.front().modified);
+  bool saw_unmodified = false;
+  for (auto& pass : stats.passes) {
+    if (!pass.modified) {
+      saw_unmodified = true;
+      CHECK(pass.nkeys == 0);
+      for (Int d = 0; d < DIMS; ++d) {
+        CHECK(pass.nents_after[d] == pass.nents_before[d]);
+      }
+      continue;
+    }
+    CHECK(0 < pass.nkeys && 0 < pass.ncands);
+    if (pass.op == "refine") {
+      CHECK(pass.nkeys <= pass.ncands);
+      CHECK(pass.nents_after[TRI] > pass.nents_before[TRI]);
+    }
+    CHECK(pass.nents_before[TET] == 0);
+    CHECK(0.0 < pass.min_quality && pass.min_quality <= pass.max_quality);
+    CHECK(pass.modification_time >= 0.0 && pass.transfer_time >= 0.0);
+  }
+  for (std::size_t i = 1; i < stats.passes.size(); ++i) {
+    for (Int d = 0; d < DIMS; ++d) {
+      CHECK(stats.passes[i].nents_before[d] ==
+            stats.passes[i - 1].nents_after[d]);
+    }
+  }
+  CHECK(saw_unmodified);
+  CHECK(stats.passes.back().nents_after[TRI] == mesh.nelems());
+  std::stringstream stream;
+  write_json(stream, stats);
+  CHECK(stream.str().find("\"op\": \"refine\"") != std::string::npos);
+  CHECK(stream.str().find("\"modified\": false") != std::string::npos);
+}
+
+static Reals quadratic_size(Reals coords) {
+  auto npts = coords.size() / 2;
+  Write<Real> size(npts);
+  auto f = LAMBDA(LO v) {
+    auto x = get_vector<2>(coords, v);
+    size[v] = 0.05 + x[0] * x[0] / 4.0;
+  };
+  parallel_for(npts, f);
+  return size;
+}
+
+static void test_tag_function(Library const& lib) {
+  Mesh mesh;
+  build_box(&mesh, lib, 1, 1, 0, 2, 2, 0);
+  classify_by_angles(&mesh, PI / 4);
+  mesh.add_tag<Real>(VERT, "size", 1, OMEGA_H_LINEAR_INTERP, OMEGA_H_DO_OUTPUT);
+  mesh.set_tag_function("size", quadratic_size);
+  CHECK(mesh.has_tag_function("size"));
+  auto nverts = mesh.nverts();
+  while (refine_by_size(&mesh, 1.5, 0.3, false));
+  CHECK(mesh.nverts() > nverts);
+  /* new vertices got exact values, not interpolated ones */
+  CHECK(are_close(mesh.get_array<Real>(VERT, "size"),
+      quadratic_size(mesh.coords())));
+  CHECK(mesh.has_tag_function("size"));
+  mesh.remove_tag(VERT, "size");
+  CHECK(!mesh.has_tag_function("size"));
+}
+
+/* marks the triangles whose vertices all have x in [lo, hi] */
+static Read<I8> mark_tris_between(Mesh* mesh, Real lo, Real hi) {
+  auto coords = mesh->coords();
+  auto tv2v = mesh->ask_verts_of(TRI);
+  Write<I8> marks(mesh->ntris());
+  auto f = LAMBDA(LO t) {
+    I8 in = 1;
+    for (Int ttv = 0; ttv < 3; ++ttv) {
+      auto x = coords[tv2v[t * 3 + ttv] * 2];
+      if (x < lo || hi < x) in = 0;
+    }
+    marks[t] = in;
+  };
+  parallel_for(mesh->ntris(), f);
+  return marks;
+}
+
+static void test_adapt_region(Library const& lib) {
+  Mesh mesh;
+  build_box(&mesh, lib, 1, 1, 0, 4, 4, 0);
+  classify_by_angles(&mesh, PI / 4);
+  mesh.add_tag(VERT, "size", 1, OMEGA_H_LINEAR_INTERP, OMEGA_H_DO_OUTPUT,
+      Reals(mesh.nverts(), 0.1));
+  mesh.add_tag(TRI, "region", 1, OMEGA_H_INHERIT, OMEGA_H_DO_OUTPUT,
+      mark_tris_between(&mesh, 0.0, 0.25));
+  auto nfar = sum(mark_tris_between(&mesh, 0.5, 1.0));
+  auto nnear = sum(mesh.get_array<I8>(TRI, "region"));
+  AdaptOpts opts;
+  opts.verbosity = 0;
+  opts.region_name = "region";
+  opts.region_nlayers = 0;
+  CHECK(adapt(&mesh, opts));
+  /* the far half is untouched, the region itself was refined */
+  CHECK(sum(mark_tris_between(&mesh, 0.5, 1.0)) == nfar);
+  CHECK(sum(mesh.get_array<I8>(TRI, "region")) > 4 * nnear);
+  CHECK(min(mesh.ask_qualities()) > 0.0);
+  /* nothing adapt() used to track the region is left behind */
+  CHECK(!mesh.has_tag(EDGE, "region"));
+  CHECK(!mesh.has_tag(TRI, "omega_h_region"));
+}
+
+/* swapping inside a region keeps the element-only region tag */
+static void test_swap_region(Library const& lib) {
+  Mesh mesh;
+  build_box(&mesh, lib, 1, 1, 0, 4, 4, 0);
+  classify_by_angles(&mesh, PI / 4);
+  auto coords = mesh.coords();
+  Write<Real> sheared(coords.size());
+  auto f = LAMBDA(LO v) {
+    sheared[v * 2 + 0] = coords[v * 2 + 0];
+    sheared[v * 2 + 1] = coords[v * 2 + 1] + coords[v * 2 + 0] / 2.0;
+  };
+  parallel_for(mesh.nverts(), f);
+  mesh.set_coords(sheared);
+  mesh.add_tag(VERT, "size", 1, OMEGA_H_LINEAR_INTERP, OMEGA_H_DO_OUTPUT,
+      Reals(mesh.nverts(), 0.3));
+  mesh.add_tag(TRI, "region", 1, OMEGA_H_INHERIT, OMEGA_H_DO_OUTPUT,
+      mark_tris_between(&mesh, 0.0, 0.5));
+  auto qual_before = mesh.min_quality();
+  AdaptStats stats;
+  AdaptOpts opts;
+  opts.verbosity = 0;
+  opts.region_name = "region";
+  opts.region_nlayers = 0;
+  opts.qual_ceil = 0.8;
+  opts.len_floor = 0.2;
+  opts.len_ceil = 4.0;
+  opts.stats = &stats;
+  CHECK(adapt(&mesh, opts));
+  bool swapped = false;
+  for (auto& pass : stats.passes) {
+    if (pass.op == "swap" && pass.modified) swapped = true;
+  }
+  CHECK(swapped);
+  auto region = mesh.get_array<I8>(TRI, "region");
+  CHECK(region == mark_tris_between(&mesh, 0.0, 0.5));
+  auto quals = unmap(collect_marked(region), mesh.ask_qualities(), 1);
+  CHECK(min(quals) > qual_before);
+  CHECK(mesh.min_quality() == qual_before);
+  CHECK(!mesh.has_tag(EDGE, "region"));
+}
+
+/* modification matches the products' lows only among the cavity,
+   which must agree with reflecting down over the whole mesh */
+static void check_down_adjs(Mesh* mesh) {
+  for (Int high_dim = TRI; high_dim <= mesh->dim(); ++high_dim) {
+    auto low_dim = high_dim - 1;
+    auto expected = reflect_down(mesh->ask_verts_of(high_dim),
+        mesh->ask_verts_of(low_dim), mesh->ask_up(VERT, low_dim), high_dim,
+        low_dim);
+    auto actual = mesh->ask_down(high_dim, low_dim);
+    CHECK(actual.ab2b == expected.ab2b);
+    CHECK(actual.codes == expected.codes);
+  }
+}
+
+static void test_modify_conn(Library const& lib) {
+  Mesh mesh;
+  build_box(&mesh, lib, 1, 1, 1, 4, 4, 4);
+  classify_by_angles(&mesh, PI / 4);
+  auto coords = mesh.coords();
+  Write<Real> sheared(coords.size());
+  Write<Real> size(mesh.nverts());
+  auto f = LAMBDA(LO v) {
+    auto x = get_vector<3>(coords, v);
+    size[v] = (x[0] + x[1] + x[2] < 1.0) ? 0.1 : 0.25;
+    x[1] += x[0] / 2.0;
+    set_vector(sheared, v, x);
+  };
+  parallel_for(mesh.nverts(), f);
+  mesh.set_coords(sheared);
+  mesh.add_tag(VERT, "size", 1, OMEGA_H_LINEAR_INTERP, OMEGA_H_DO_OUTPUT,
+      Reals(size));
+  CHECK(swap_edges(&mesh, 0.9, 2, false));
+  check_down_adjs(&mesh);
+  CHECK(refine_by_size(&mesh, 1.5, 0.0, false));
+  check_down_adjs(&mesh);
+  mesh.set_tag(VERT, "size", Reals(mesh.nverts(), 0.6));
+  if (mesh.has_tag(EDGE, "length")) mesh.remove_tag(EDGE, "length");
+  CHECK(coarsen_by_size(&mesh, 0.5, 0.0, false));
+  check_down_adjs(&mesh);
+}
+
 static void test_compare_meshes(Library const& lib) {
   Mesh a;
   build_box(&a, lib, 1, 1, 0, 4, 4, 0);
@@ -810,12 +1170,25 @@ int main(int argc, char** argv) {
   test_quality();
   test_file_components();
   test_linpart();
+  test_array_bytes();
+#ifndef OMEGA_H_USE_KOKKOS
+  test_release_modified(lib);
+#endif
   test_expand();
   test_inertial_bisect();
   test_average_field(lib);
   test_positivize();
   test_refine_qualities(lib);
   test_mark_up_down(lib);
+  test_indset(lib);
+  test_colors(lib);
+  test_refine_by_templates(lib);
+  test_refine_uniformly(lib);
+  test_adapt_region(lib);
+  test_swap_region(lib);
+  test_modify_conn(lib);
+  test_tag_function(lib);
+  test_adapt_stats(lib);
   test_compare_meshes(lib);
   test_swap2d_topology(lib);
   test_swap3d_loop(lib);